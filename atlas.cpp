@@ -0,0 +1,128 @@
+// Block texture atlas, every tile in one texture so the world draws with a single material
+#pragma once
+#include <cstdlib>
+#include <cstring>
+#include "raylib/include/raylib.h"
+#include "mesher.cpp"
+
+namespace atlas
+{
+    const int TILE = 16;              // tile size in pixels
+    const int PAD = TILE / 2;         // wrapped border around each tile, filtering never reaches the neighbours
+    const int CELL = TILE + 2 * PAD;  // power of two, so 2x2 box filtered mips never mix cells
+    const int COLUMNS = 4;
+    const int ROWS = (mesher::TILE_COUNT + COLUMNS - 1) / COLUMNS;
+    const int WIDTH = COLUMNS * CELL, HEIGHT = ROWS * CELL;
+
+    struct Atlas {
+        Texture texture;
+        float uv[mesher::TILE_COUNT][2];  // top left of each tile, in texture coordinates
+        float tile_uv[2];                 // size of a tile, in texture coordinates
+        Shader shader;
+        Material material;
+    };
+
+    // merged quads repeat their tile, so the uv is wrapped here instead of by the sampler
+    // NOTE: gradients come from the unwrapped uv, or every block edge picks the smallest mip
+    const char *VS = R"(#version 330
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in vec2 vertexTexCoord2;
+in vec4 vertexColor;
+uniform mat4 mvp;
+out vec2 fragTexCoord;
+out vec2 fragTile;
+out vec4 fragColor;
+void main() {
+    fragTexCoord = vertexTexCoord;
+    fragTile = vertexTexCoord2;
+    fragColor = vertexColor;
+    gl_Position = mvp*vec4(vertexPosition, 1.0);
+})";
+
+    const char *FS = R"(#version 330
+in vec2 fragTexCoord;
+in vec2 fragTile;
+in vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+uniform vec2 tileSize;
+out vec4 finalColor;
+void main() {
+    vec2 uv = fragTile + fract(fragTexCoord)*tileSize;
+    vec2 g = fragTexCoord*tileSize;
+    finalColor = textureGrad(texture0, uv, dFdx(g), dFdy(g))*colDiffuse*fragColor;
+})";
+
+    // pack TILE x TILE images (indexed by mesher::tile) into one texture with its full mip chain
+    Atlas Load(Image tiles[mesher::TILE_COUNT]) {
+        Atlas a;
+        int levels = 1;
+        while ((CELL >> levels) > 0) levels++;
+
+        size_t total = 0;
+        for (int l = 0; l < levels; l++) total += (WIDTH >> l) * (HEIGHT >> l);
+        Color *pixels = (Color *)calloc(total, sizeof(Color));
+
+        // level 0, each tile repeated into its padded cell
+        for (int t = 0; t < mesher::TILE_COUNT; t++) {
+            Image img = ImageCopy(tiles[t]);
+            ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+            Color *src = LoadImageColors(img);
+            int ox = (t % COLUMNS) * CELL, oy = (t / COLUMNS) * CELL;
+            for (int y = 0; y < CELL; y++) {
+                for (int x = 0; x < CELL; x++) {
+                    int sx = (x - PAD + TILE) % TILE, sy = (y - PAD + TILE) % TILE;
+                    pixels[(oy + y) * WIDTH + ox + x] = src[sy * img.width + sx];
+                }
+            }
+            UnloadImageColors(src);
+            UnloadImage(img);
+
+            a.uv[t][0] = (float)(ox + PAD) / WIDTH;
+            a.uv[t][1] = (float)(oy + PAD) / HEIGHT;
+        }
+        a.tile_uv[0] = (float)TILE / WIDTH;
+        a.tile_uv[1] = (float)TILE / HEIGHT;
+
+        // mips, plain 2x2 averages stored one after another
+        Color *prev = pixels;
+        for (int l = 1; l < levels; l++) {
+            int pw = WIDTH >> (l - 1), w = WIDTH >> l, h = HEIGHT >> l;
+            Color *cur = prev + pw * (HEIGHT >> (l - 1));
+            for (int y = 0; y < h; y++) {
+                for (int x = 0; x < w; x++) {
+                    const Color *p[4] = {
+                        &prev[(2 * y) * pw + 2 * x], &prev[(2 * y) * pw + 2 * x + 1],
+                        &prev[(2 * y + 1) * pw + 2 * x], &prev[(2 * y + 1) * pw + 2 * x + 1]
+                    };
+                    cur[y * w + x] = Color {
+                        (unsigned char)((p[0]->r + p[1]->r + p[2]->r + p[3]->r + 2) / 4),
+                        (unsigned char)((p[0]->g + p[1]->g + p[2]->g + p[3]->g + 2) / 4),
+                        (unsigned char)((p[0]->b + p[1]->b + p[2]->b + p[3]->b + 2) / 4),
+                        (unsigned char)((p[0]->a + p[1]->a + p[2]->a + p[3]->a + 2) / 4)
+                    };
+                }
+            }
+            prev = cur;
+        }
+
+        Image packed = { pixels, WIDTH, HEIGHT, levels, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+        a.texture = LoadTextureFromImage(packed);
+        SetTextureFilter(a.texture, TEXTURE_FILTER_POINT);
+        SetTextureWrap(a.texture, TEXTURE_WRAP_CLAMP);
+        UnloadImage(packed);
+
+        a.shader = LoadShaderFromMemory(VS, FS);
+        SetShaderValue(a.shader, GetShaderLocation(a.shader, "tileSize"), a.tile_uv, SHADER_UNIFORM_VEC2);
+        a.material = LoadMaterialDefault();
+        a.material.shader = a.shader;
+        a.material.maps[MATERIAL_MAP_DIFFUSE].texture = a.texture;
+        return a;
+    }
+
+    void Unload(Atlas &a) {
+        UnloadShader(a.shader);
+        UnloadTexture(a.texture);
+    }
+}
@@ -0,0 +1,1369 @@
+// Headless benchmark suite, no window or GPU needed
+// ./bench.out [--quick] [--budget blocks] > results.json
+// ./bench.out --replay session.rcin > replay.json
+// ./bench.out --render preview.png > render.json
+// NOTE: results go to stdout as one JSON document, a readable line per result goes to stderr
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "edit.cpp"
+#include "jobs.cpp"
+#include "light.cpp"
+#include "lod.cpp"
+#include "mesher.cpp"
+#include "occlusion.cpp"
+#include "profile.cpp"
+#include "raycast.cpp"
+#include "render.cpp"
+#include "sim.cpp"
+#include "stream.cpp"
+#include "tick.cpp"
+
+using bench_clock = std::chrono::steady_clock;
+
+double seconds_since(bench_clock::time_point t0) {
+    return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+// one result, a flat JSON object; keys carry their unit (_s, _ms, _us, _ns)
+struct Record {
+    std::string json, text;
+
+    Record(const char *bench) {
+        json = std::string("{\"bench\": \"") + bench + "\"";
+        text = bench;
+    }
+
+    Record &add(const char *key, const char *v) {
+        json += std::string(", \"") + key + "\": \"" + v + "\"";
+        text += std::string("  ") + key + "=" + v;
+        return *this;
+    }
+
+    template <typename T>
+    Record &add(const char *key, T v) {
+        char buf[64];
+        if (std::is_same<T, bool>::value) snprintf(buf, sizeof(buf), "%s", v ? "true" : "false");
+        else if (std::is_integral<T>::value) snprintf(buf, sizeof(buf), "%lld", (long long)v);
+        else if (std::isfinite((double)v)) snprintf(buf, sizeof(buf), "%.6g", (double)v);
+        else snprintf(buf, sizeof(buf), "null");
+        json += std::string(", \"") + key + "\": " + buf;
+        text += std::string("  ") + key + "=" + buf;
+        return *this;
+    }
+};
+
+std::vector<std::string> results;
+
+void emit(Record &r) {
+    fprintf(stderr, "%s\n", r.text.c_str());
+    results.push_back(r.json + "}");
+}
+
+// the old flat block list and its linear getTallestY, kept here as the baseline
+struct OldCube {
+    float position[3];
+    float scales[3] = {1, 1, 1};
+    unsigned char color[4] = {0, 0, 0, 255};
+    int type = 0;
+};
+
+float old_getTallestY(const std::vector<OldCube> &blocks, float _x, float _z) {
+    float r = -1.0f;
+    int px = _x, pz = _z;
+    for (const auto &blk : blocks) {
+        int cx = blk.position[0];
+        int cy = blk.position[1];
+        float cz = blk.position[2];
+        if (px == cx && pz == cz && cy > r) r = blk.position[1];
+    }
+    return r == -1 ? 0 : r;
+}
+
+// the old pick, every block within 6 of the camera tested against the ray until one hits
+bool old_pick(const std::vector<OldCube> &blocks, const float origin[3], const float direction[3]) {
+    for (const auto &cb : blocks) {
+        float d[3], dist = 0;
+        for (int a = 0; a < 3; a++) {
+            d[a] = cb.position[a] - origin[a];
+            dist += d[a] * d[a];
+        }
+        if ((int)sqrtf(dist) >= 6) continue;
+
+        // slab test against the unit box around the block position
+        float t0 = 0, t1 = INFINITY;
+        for (int a = 0; a < 3; a++) {
+            float inv = 1.0f / direction[a];
+            float ta = (cb.position[a] - 0.5f - origin[a]) * inv, tb = (cb.position[a] + 0.5f - origin[a]) * inv;
+            t0 = std::max(t0, std::min(ta, tb));
+            t1 = std::min(t1, std::max(ta, tb));
+        }
+        if (t0 <= t1) return true;
+    }
+    return false;
+}
+
+// flatten a world into the old block list
+void old_populate(std::vector<OldCube> &blocks, const world::World &w) {
+    blocks.reserve(w.block_count());
+    for (const auto &it : w.chunks) {
+        const world::Chunk &c = *it.second;
+        for (int y = 0; y < world::CHUNK_HEIGHT; y++)
+            for (int lz = 0; lz < world::CHUNK_SIZE; lz++)
+                for (int lx = 0; lx < world::CHUNK_SIZE; lx++)
+                    if (c.get(lx, y, lz) != Air)
+                        blocks.push_back(OldCube { {(float)(c.cx * world::CHUNK_SIZE + lx), (float)y, (float)(c.cz * world::CHUNK_SIZE + lz)} });
+    }
+}
+
+// the game's terrain settings
+world::Terrain bench_terrain(int seed = perlin::SEED) {
+    world::Terrain t;
+    t.noise = perlin::Noise(seed, 4, 0.03f, 2.0f, 0.5f);
+    t.amplitude = 24;
+    return t;
+}
+
+// fnv-1a over every chunk in key order, to check generation is identical across thread counts
+unsigned long long world_hash(const world::World &w) {
+    std::vector<long long> keys;
+    for (const auto &it : w.chunks) keys.push_back(it.first);
+    std::sort(keys.begin(), keys.end());
+    unsigned long long h = 1469598103934665603ull;
+    for (long long k : keys) {
+        const world::Chunk *c = w.chunks.at(k).get();
+        for (int i = 0; i < world::CHUNK_VOLUME; i++) h = (h ^ c->blocks[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+// generation and ground height queries, the heightmap vs the old linear scan
+void bench_gen(const world::World &w, int size, int seed, double gen, size_t old_budget) {
+    srand(size ^ seed);
+    const int queries = 1 << 20;
+    std::vector<int> qx(queries), qz(queries);
+    for (int i = 0; i < queries; i++) { qx[i] = rand() % size; qz[i] = rand() % size; }
+
+    volatile long long sink = 0;
+    auto t0 = bench_clock::now();
+    for (int i = 0; i < queries; i++) sink += w.top(qx[i], qz[i]);
+    double per_new = seconds_since(t0) / queries;
+
+    Record r("gen");
+    r.add("size", size).add("seed", seed).add("chunks", w.chunks.size()).add("blocks", w.block_count())
+     .add("gen_s", gen).add("query_ns", per_new * 1e9);
+
+    // the old path only for the default seed, skipped when it would not fit in memory
+    if (seed == perlin::SEED) {
+        double per_old;
+        bool extrapolated = w.block_count() > old_budget;
+        if (!extrapolated) {
+            std::vector<OldCube> blocks;
+            old_populate(blocks, w);
+            const int old_queries = 16;
+            t0 = bench_clock::now();
+            for (int i = 0; i < old_queries; i++) sink += old_getTallestY(blocks, qx[i], qz[i]);
+            per_old = seconds_since(t0) / old_queries;
+        } else {
+            // the scan is linear in block count, scale a measurement that does fit
+            int small = 250;
+            world::World sw;
+            world::populate(sw, bench_terrain(seed), small);
+            std::vector<OldCube> blocks;
+            old_populate(blocks, sw);
+            const int old_queries = 64;
+            t0 = bench_clock::now();
+            for (int i = 0; i < old_queries; i++) sink += old_getTallestY(blocks, qx[i] % small, qz[i] % small);
+            per_old = seconds_since(t0) / old_queries * ((double)w.block_count() / blocks.size());
+        }
+        r.add("old_query_us", per_old * 1e6).add("old_extrapolated", extrapolated).add("speedup", per_old / per_new);
+    }
+    emit(r);
+}
+
+// view rays from eye height above random columns, at the game's reach and a long one
+void bench_pick(const world::World &w, int size, int seed, size_t old_budget) {
+    srand(size ^ seed);
+    const int rays = 1 << 16;
+    std::vector<float> origins(rays * 3), directions(rays * 3);
+    for (int i = 0; i < rays; i++) {
+        int x = rand() % size, z = rand() % size;
+        origins[i * 3 + 0] = x + 0.5f;
+        origins[i * 3 + 1] = std::max(w.top(x, z), 0) + 1 + 4.0f;
+        origins[i * 3 + 2] = z + 0.5f;
+        // mostly looking down at the ground in front, like when building
+        float yaw = rand() / (float)RAND_MAX * 6.2831853f, pitch = -rand() / (float)RAND_MAX * 1.4f;
+        directions[i * 3 + 0] = cosf(pitch) * cosf(yaw);
+        directions[i * 3 + 1] = sinf(pitch);
+        directions[i * 3 + 2] = cosf(pitch) * sinf(yaw);
+    }
+
+    for (float reach : {6.0f, 64.0f}) {
+        size_t hits = 0, steps = 0;
+        auto t0 = bench_clock::now();
+        for (int i = 0; i < rays; i++) {
+            raycast::Hit h = raycast::cast(w, &origins[i * 3], &directions[i * 3], reach);
+            hits += h.hit;
+            steps += h.steps;
+        }
+        double per = seconds_since(t0) / rays;
+
+        Record r("pick");
+        r.add("size", size).add("seed", seed).add("reach", reach).add("ray_ns", per * 1e9)
+         .add("hit_rate", (double)hits / rays).add("steps", (double)steps / rays);
+        if (reach == 6.0f && seed == perlin::SEED && w.block_count() <= old_budget) {
+            std::vector<OldCube> blocks;
+            old_populate(blocks, w);
+            const int old_rays = 16;
+            volatile int sink = 0;
+            t0 = bench_clock::now();
+            for (int i = 0; i < old_rays; i++) sink += old_pick(blocks, &origins[i * 3], &directions[i * 3]);
+            double per_old = seconds_since(t0) / old_rays;
+            r.add("old_ray_us", per_old * 1e6).add("speedup", per_old / per);
+        }
+        emit(r);
+    }
+}
+
+// chunk meshing, faces per block drawn the old way vs culled vs greedy merged, and greedy merged without
+// corner occlusion for what ao costs in time and quads
+void bench_mesh(const world::World &w, int size, int seed) {
+    size_t naive = w.block_count() * 6, culled = 0, greedy = 0, area = 0, flat = 0, shaded = 0;
+    mesher::ChunkMesh cm;
+    for (const auto &it : w.chunks) {
+        mesher::build(w, it.second->cx, it.second->cz, cm, false);
+        culled += cm.quads.size();
+    }
+
+    auto t0 = bench_clock::now();
+    for (const auto &it : w.chunks) {
+        mesher::build(w, it.second->cx, it.second->cz, cm, true, false);
+        flat += cm.quads.size();
+    }
+    double no_ao = seconds_since(t0);
+
+    t0 = bench_clock::now();
+    for (const auto &it : w.chunks) {
+        mesher::build(w, it.second->cx, it.second->cz, cm);
+        greedy += cm.quads.size();
+        for (const auto &q : cm.quads) {
+            area += q.size[0] * q.size[1] * q.size[2];
+            shaded += q.ao != 0;
+        }
+    }
+    double t = seconds_since(t0);
+
+    // a chunk past where a short coordinate wraps, every quad has to land inside it
+    const int far = 3000;
+    world::World distant;
+    world::Chunk *c = new world::Chunk(far, far);
+    world::generate(*c, bench_terrain(seed));
+    distant.chunks[world::key(far, far)].reset(c);
+    mesher::build(distant, far, far, cm);
+    bool far_ok = !cm.quads.empty();
+    for (const auto &q : cm.quads)
+        far_ok &= q.x >= far * world::CHUNK_SIZE && q.x + q.size[0] <= (far + 1) * world::CHUNK_SIZE &&
+                  q.z >= far * world::CHUNK_SIZE && q.z + q.size[2] <= (far + 1) * world::CHUNK_SIZE;
+
+    Record r("mesh");
+    r.add("size", size).add("seed", seed).add("chunks", w.chunks.size())
+     .add("quads_naive", naive).add("quads_culled", culled).add("quads_greedy", greedy)
+     .add("chunk_us", t / w.chunks.size() * 1e6).add("area_ok", area == culled)
+     .add("quads_no_ao", flat).add("chunk_us_no_ao", no_ao / w.chunks.size() * 1e6).add("quads_occluded", shaded)
+     .add("far_ok", far_ok);
+    emit(r);
+}
+
+// one map, generated once and shared by the query, pick and mesh benchmarks
+void bench_map(int size, int seed, size_t old_budget) {
+    world::World w;
+    auto t0 = bench_clock::now();
+    world::populate(w, bench_terrain(seed), size);
+    double gen = seconds_since(t0);
+
+    bench_gen(w, size, seed, gen, old_budget);
+    bench_pick(w, size, seed, old_budget);
+    bench_mesh(w, size, seed);
+}
+
+// map generation wall time against thread count
+void bench_startup(int size) {
+    int cores = std::thread::hardware_concurrency();
+    double base = 0;
+    unsigned long long reference = 0;
+    {
+        // warm up the allocator, the first run otherwise pays for faulting in all the pages
+        world::World w;
+        world::populate(w, bench_terrain(), size);
+    }
+    std::vector<int> counts = {1, 2, 4};
+    if (std::find(counts.begin(), counts.end(), cores) == counts.end()) counts.push_back(cores);
+    for (int threads : counts) {
+        world::World w;
+        auto t0 = bench_clock::now();
+        world::populate(w, bench_terrain(), size, threads);
+        double t = seconds_since(t0);
+        unsigned long long h = world_hash(w);
+        if (threads == 1) { base = t; reference = h; }
+
+        Record r("startup");
+        r.add("size", size).add("threads", threads).add("gen_s", t).add("speedup", base / t)
+         .add("identical", h == reference);
+        emit(r);
+    }
+}
+
+// batch fBm kernels against the one-sample-at-a-time path
+void bench_noise(int octaves) {
+    const int w = 1024, h = 256;
+    perlin::Noise noise(perlin::SEED, octaves);
+    std::vector<float> reference(w * h), out(w * h);
+
+    auto t0 = bench_clock::now();
+    for (int j = 0; j < h; j++)
+        for (int i = 0; i < w; i++) reference[j * w + i] = noise.fbm2d(i, j);
+    double base = seconds_since(t0);
+    Record r("noise");
+    r.add("octaves", octaves).add("kernel", "fbm2d").add("msamples_per_s", w * h / base / 1e6);
+    emit(r);
+
+    int count;
+    const perlin::Kernel *k = perlin::kernels(&count);
+    for (int n = 0; n < count; n++) {
+        Record r("noise");
+        r.add("octaves", octaves).add("kernel", k[n].name).add("supported", k[n].supported);
+        if (!k[n].supported) { emit(r); continue; }
+
+        t0 = bench_clock::now();
+        for (int j = 0; j < h; j++) k[n].row(noise, -512, j, w, out.data() + j * w);
+        double t = seconds_since(t0);
+        // the batch rows start at -512 to cover negative coordinates too
+        float diff = 0;
+        for (int j = 0; j < h; j++)
+            for (int i = 0; i < w; i++) diff = std::max(diff, fabsf(out[j * w + i] - noise.fbm2d(i - 512, j)));
+        r.add("msamples_per_s", w * h / t / 1e6).add("speedup", base / t).add("max_diff", diff)
+         .add("selected", &k[n] == &perlin::kernel());
+        emit(r);
+    }
+}
+
+// regenerating chunks with the column cache warm vs cold
+void bench_cache(int size) {
+    world::ColumnCache cache(1 << 20);
+    world::Terrain t = bench_terrain();
+    t.cache = &cache;
+
+    double times[2];
+    for (int pass = 0; pass < 2; pass++) {
+        world::World w;
+        auto t0 = bench_clock::now();
+        world::populate(w, t, size);
+        times[pass] = seconds_since(t0);
+    }
+
+    // the same seed at another amplitude through the same cache, it must not be handed the first terrain's heights
+    world::Terrain other = bench_terrain();
+    other.amplitude *= 0.5f;
+    world::World plain, shared;
+    world::populate(plain, other, size);
+    other.cache = &cache;
+    world::populate(shared, other, size);
+
+    Record r("cache");
+    r.add("size", size).add("cold_s", times[0]).add("cached_s", times[1]).add("hits", cache.hits).add("misses", cache.misses)
+     .add("shared_ok", world_hash(plain) == world_hash(shared));
+    emit(r);
+}
+
+// walk in a straight line through a streamed world, main thread cost per frame and chunks kept
+void bench_stream(int frames) {
+    world::ColumnCache cache;
+    world::Terrain t = bench_terrain();
+    t.cache = &cache;
+    world::World w;
+    jobs::Pool pool;
+    stream::Streamer streamer(pool, &t, 8);
+
+    size_t meshes = 0, max_loaded = 0;
+    double total = 0, worst = 0;
+    float x = 8.5f, z = 8.5f;
+    for (int f = 0; f < frames; f++) {
+        auto t0 = bench_clock::now();
+        int pcx = world::chunk_of(floorf(x)), pcz = world::chunk_of(floorf(z));
+        streamer.update(w, pcx, pcz, [](int, int) {});
+        streamer.drain(w, 0.002, [&](const mesher::ChunkMesh &) { meshes++; });
+        streamer.schedule(w, pcx, pcz, 0.002);
+        double dt = seconds_since(t0);
+        total += dt;
+        worst = std::max(worst, dt);
+        max_loaded = std::max(max_loaded, w.chunks.size());
+
+        // about a sprint, and give the workers the rest of a 60 fps frame
+        x += 0.25f;
+        std::this_thread::sleep_for(std::chrono::microseconds((int)std::max(0.0, 16667 - dt * 1e6)));
+    }
+    jobs::Stats gen = pool.stats(streamer.generate_channel), mesh = pool.stats(streamer.mesh_channel);
+    Record r("stream");
+    r.add("frames", frames).add("walked", x - 8.5f).add("frame_avg_ms", total / frames * 1e3)
+     .add("frame_worst_ms", worst * 1e3).add("meshes", meshes).add("loaded_max", max_loaded)
+     .add("generate_wait_ms", gen.wait_avg).add("generate_wait_max_ms", gen.wait_max)
+     .add("mesh_wait_ms", mesh.wait_avg).add("mesh_wait_max_ms", mesh.wait_max);
+    emit(r);
+}
+
+// generation with caves against the same terrain as plain height columns, one thread, best of three; the game's
+// terrain and a low one that mostly stays under the cave band
+// NOTE: `sampled` is the chunks that looked at the cave noise at all, `carved` the share of the column blocks dug out
+void bench_caves(int size) {
+    int n = (size + world::CHUNK_SIZE - 1) / world::CHUNK_SIZE;
+    for (float amplitude : {24.0f, 5.0f}) {
+        double times[2];
+        size_t blocks[2] = {0, 0}, sampled = 0;
+        for (int caves = 0; caves < 2; caves++) {
+            world::Terrain t = bench_terrain();
+            t.amplitude = amplitude;
+            if (!caves) t.hollow = 1;
+            times[caves] = INFINITY;
+            for (int run = 0; run < 3; run++) {
+                blocks[caves] = sampled = 0;
+                double spent = 0;
+                for (int i = 0; i < n * n; i++) {
+                    std::unique_ptr<world::Chunk> c(new world::Chunk(i / n, i % n));
+                    auto t0 = bench_clock::now();
+                    sampled += world::generate(*c, t, size);
+                    spent += seconds_since(t0);
+                    blocks[caves] += c->solid;
+                }
+                times[caves] = std::min(times[caves], spent);
+            }
+        }
+        Record r("caves");
+        r.add("size", size).add("amplitude", amplitude).add("chunks", n * n).add("columns_us", times[0] / (n * n) * 1e6)
+         .add("caves_us", times[1] / (n * n) * 1e6).add("overhead", times[1] / times[0] - 1).add("sampled", sampled)
+         .add("carved", 1 - (double)blocks[1] / blocks[0]);
+        emit(r);
+    }
+}
+
+// starting a saved world against generating it again, and how much an edit rewrites
+void bench_region(int size) {
+    char dir[] = "/tmp/raycraft-bench-XXXXXX";
+    if (!mkdtemp(dir)) { fprintf(stderr, "region  no temporary directory\n"); return; }
+    world::Terrain t = bench_terrain();
+
+    size_t bytes, chunks;
+    double save;
+    unsigned long long reference;
+    {
+        world::World w;
+        world::populate(w, t, size, 1);
+        reference = world_hash(w);
+        chunks = w.chunks.size();
+        region::Store store(dir, t.noise.seed);
+        auto t0 = bench_clock::now();
+        store.save(w);
+        save = seconds_since(t0);
+        bytes = store.written;
+    }
+
+    // both into a fresh world, after the first one gave its memory back
+    double gen, load;
+    {
+        world::World w;
+        auto t0 = bench_clock::now();
+        world::populate(w, t, size, 1);
+        gen = seconds_since(t0);
+    }
+    world::World w;
+    unsigned long long h;
+    {
+        // a fresh store too, as on the next launch
+        region::Store store(dir, t.noise.seed);
+        int n = (size + world::CHUNK_SIZE - 1) / world::CHUNK_SIZE;
+        auto t0 = bench_clock::now();
+        for (int cx = 0; cx < n; cx++) {
+            for (int cz = 0; cz < n; cz++) {
+                world::Chunk *c = new world::Chunk(cx, cz);
+                store.load(*c);
+                w.chunks[world::key(cx, cz)].reset(c);
+            }
+        }
+        load = seconds_since(t0);
+        h = world_hash(w);
+    }
+
+    // the same chunks loaded from a pool, each decode runs outside the store's lock
+    double load_parallel;
+    bool parallel_identical;
+    {
+        region::Store store(dir, t.noise.seed);
+        jobs::Pool pool(std::max(jobs::Pool().workers(), 3));
+        int n = (size + world::CHUNK_SIZE - 1) / world::CHUNK_SIZE;
+        std::vector<std::unique_ptr<world::Chunk>> loaded(n * n);
+        auto t0 = bench_clock::now();
+        pool.run(pool.channel("load"), n * n, [&](int i) {
+            loaded[i].reset(new world::Chunk(i / n, i % n));
+            store.load(*loaded[i]);
+        });
+        load_parallel = seconds_since(t0);
+        world::World p;
+        for (auto &c : loaded) p.chunks[world::key(c->cx, c->cz)] = std::move(c);
+        parallel_identical = world_hash(p) == reference && store.loaded == (size_t)n * n;
+    }
+
+    size_t edited, edit_bytes;
+    double edit_save;
+    {
+        region::Store store(dir, t.noise.seed);
+        for (int i = 0; i < 3; i++) w.set(size / 2 + i, world::CHUNK_HEIGHT - 1, size / 2, CubeType::Dirt);
+        auto t0 = bench_clock::now();
+        edited = store.save(w);
+        edit_save = seconds_since(t0);
+        edit_bytes = store.written;
+    }
+
+    Record r("region");
+    r.add("size", size).add("chunks", chunks).add("bytes", bytes).add("bytes_per_chunk", (double)bytes / chunks)
+     .add("save_s", save).add("load_s", load).add("gen_s", gen).add("speedup", gen / load)
+     .add("identical", h == reference).add("load_parallel_s", load_parallel)
+     .add("parallel_identical", parallel_identical).add("edit_chunks", edited).add("edit_bytes", edit_bytes)
+     .add("edit_save_ms", edit_save * 1e3);
+    emit(r);
+
+    std::string rm = std::string("rm -rf ") + dir;
+    if (system(rm.c_str())) {}
+}
+
+// clicks through the edit queue, then meshing only the chunks they touched
+void bench_edit(int size, size_t old_budget) {
+    world::World w;
+    world::populate(w, bench_terrain(), size);
+    srand(size);
+
+    const int clicks = 2000;
+    world::EditQueue edits;
+    std::unordered_set<long long> dirty;
+    mesher::ChunkMesh cm;
+    double apply = 0, remesh = 0;
+    size_t remeshed = 0;
+    for (int i = 0; i < clicks; i++) {
+        // break the top block of a random column, or put one back on it
+        int x = rand() % size, z = rand() % size, y = w.top(x, z);
+        auto t0 = bench_clock::now();
+        if (i % 2) edits.push(x, y + 1, z, CubeType::Dirt);
+        else edits.push(x, y, z, CubeType::Air);
+        edits.apply(w, dirty);
+        apply += seconds_since(t0);
+
+        t0 = bench_clock::now();
+        for (long long k : dirty) mesher::build(w, w.chunks.at(k)->cx, w.chunks.at(k)->cz, cm);
+        remesh += seconds_since(t0);
+        remeshed += dirty.size();
+        dirty.clear();
+    }
+
+    Record r("edit");
+    r.add("size", size).add("apply_us", apply / clicks * 1e6).add("remesh_us", remesh / clicks * 1e6)
+     .add("chunks_per_click", (double)remeshed / clicks);
+
+    // the old path, erasing one block out of the flat list
+    if (w.block_count() <= old_budget) {
+        std::vector<OldCube> blocks;
+        old_populate(blocks, w);
+        const int erases = 16;
+        auto t0 = bench_clock::now();
+        for (int i = 0; i < erases; i++) blocks.erase(blocks.begin() + rand() % blocks.size());
+        r.add("old_erase_us", seconds_since(t0) / erases * 1e6);
+    }
+    emit(r);
+}
+
+// lighting a map from scratch (seed every chunk, then join them) against relighting after single edits:
+// breaking and placing on and under the surface, and lamps; plus what light keys cost the greedy mesher
+void bench_light(int size) {
+    world::World w;
+    world::populate(w, bench_terrain(), size);
+    size_t chunks = w.chunks.size(), quads_dark = 0, quads_lit = 0;
+    mesher::ChunkMesh cm;
+    for (const auto &it : w.chunks) {
+        mesher::build(w, it.second->cx, it.second->cz, cm);
+        quads_dark += cm.quads.size();
+    }
+
+    std::unordered_set<long long> lit;
+    auto t0 = bench_clock::now();
+    for (const auto &it : w.chunks) light::seed(*it.second);
+    double seed = seconds_since(t0);
+    t0 = bench_clock::now();
+    for (const auto &it : w.chunks) light::join(w, it.second->cx, it.second->cz, lit);
+    double join = seconds_since(t0);
+    for (const auto &it : w.chunks) {
+        mesher::build(w, it.second->cx, it.second->cz, cm);
+        quads_lit += cm.quads.size();
+    }
+
+    srand(size);
+    const int edits = 2000;
+    double update = 0, worst = 0;
+    size_t cells = 0, touched = 0;
+    for (int i = 0; i < edits; i++) {
+        int x = rand() % size, z = rand() % size, top = w.top(x, z);
+        int y = i % 4 == 3 ? rand() % (top + 1) : top + (i % 2);
+        CubeType t = i % 4 == 3 ? CubeType::Air : i % 8 == 1 ? CubeType::Lamp : i % 2 ? CubeType::Dirt : CubeType::Air;
+        CubeType was = w.get(x, y, z);
+        if (y < 0 || was == t) continue;
+        w.set(x, y, z, t);
+        lit.clear();
+        auto t1 = bench_clock::now();
+        cells += light::update(w, x, y, z, was, lit);
+        double s = seconds_since(t1);
+        update += s;
+        worst = std::max(worst, s);
+        touched += lit.size();
+    }
+
+    Record r("light");
+    r.add("size", size).add("chunks", chunks).add("seed_us", seed / chunks * 1e6).add("join_us", join / chunks * 1e6)
+     .add("full_ms", (seed + join) * 1e3).add("edit_us", update / edits * 1e6).add("edit_worst_us", worst * 1e6)
+     .add("cells_per_edit", (double)cells / edits).add("chunks_per_edit", (double)touched / edits)
+     .add("quads_dark", quads_dark).add("quads_lit", quads_lit);
+    emit(r);
+}
+
+// bulk edits of a `side` x 63 x `side` box on a lit map: each one, the chunks it marks for a new mesh and the journal it leaves,
+// and the same fill as single block edits (each relit on its own) on a box an eighth of the size
+void bench_bulk(int size, int side) {
+    world::World w;
+    world::populate(w, bench_terrain(), size);
+    std::unordered_set<long long> dirty;
+    for (const auto &it : w.chunks) light::seed(*it.second);
+    for (const auto &it : w.chunks) light::join(w, it.second->cx, it.second->cz, dirty);
+
+    int x0 = (size - side) / 2, z0 = x0;
+    edit::Box box = edit::Box::between(x0, 1, z0, x0 + side - 1, side, z0 + side - 1);
+    edit::Journal journal;
+    edit::Clip clip;
+    const char *names[6] = {"fill", "replace", "copy", "paste", "undo", "redo"};
+    for (int op = 0; op < 6; op++) {
+        dirty.clear();
+        size_t blocks = 0;
+        auto t0 = bench_clock::now();
+        switch (op) {
+        case 0: blocks = edit::fill(w, box, CubeType::Stone, dirty, &journal); break;
+        case 1: blocks = edit::replace(w, box, CubeType::Stone, CubeType::Dirt, dirty, &journal); break;
+        case 2: clip = edit::copy(w, box); blocks = clip.blocks.size(); break;
+        case 3: blocks = edit::paste(w, clip, x0 + side / 2, 1, z0 - side / 2, dirty, &journal); break;
+        case 4: journal.undo(w, dirty); blocks = journal.undone.back().blocks; break;
+        case 5: journal.redo(w, dirty); blocks = journal.done.back().blocks; break;
+        }
+        double t = seconds_since(t0);
+        Record r("bulk");
+        r.add("op", names[op]).add("size", size).add("box", box.volume()).add("blocks", blocks).add("ms", t * 1e3)
+         .add("remeshed", dirty.size()).add("journal_bytes", journal.bytes());
+        emit(r);
+    }
+
+    // the same fill one block at a time through the edit queue, every block relit on its own
+    int small = side / 2;
+    edit::Box part = edit::Box::between(x0, 1, z0, x0 + small - 1, small, z0 + small - 1);
+    edit::fill(w, part, CubeType::Air, dirty);
+    world::EditQueue queue;
+    for (int y = part.y0; y <= part.y1; y++)
+        for (int z = part.z0; z <= part.z1; z++)
+            for (int x = part.x0; x <= part.x1; x++) queue.push(x, y, z, CubeType::Stone);
+    std::unordered_set<long long> lit;
+    dirty.clear();
+    auto t0 = bench_clock::now();
+    queue.apply(w, dirty, [&](int x, int y, int z, CubeType was) { light::update(w, x, y, z, was, lit); });
+    double single = seconds_since(t0);
+    edit::fill(w, part, CubeType::Air, dirty);
+    dirty.clear();
+    t0 = bench_clock::now();
+    edit::fill(w, part, CubeType::Stone, dirty);
+    double bulk = seconds_since(t0);
+    Record r("bulk");
+    r.add("op", "single_fill").add("size", size).add("box", part.volume()).add("single_ms", single * 1e3)
+     .add("bulk_ms", bulk * 1e3).add("speedup", single / bulk);
+    emit(r);
+}
+
+// cost of one profiler scope, and a trace dump of a few fake frames
+void bench_profile() {
+    const int scopes = 1 << 20;
+    auto t0 = bench_clock::now();
+    for (int i = 0; i < scopes; i++) { PROFILE_SCOPE("bench"); }
+    double per = seconds_since(t0) / scopes;
+
+    // and a followed thread busy meanwhile, like the tick thread, whose stage has to show up next to the frame's
+    const int frames = 120;
+    std::atomic<bool> stop{false};
+    std::thread ticker([&stop]() {
+        profile::name_thread("ticker");
+        profile::follow();
+        while (!stop) {
+            PROFILE_SCOPE("ticked");
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+    for (int f = 0; f <= frames; f++) {
+        profile::frame();
+        PROFILE_SCOPE("work");
+        volatile int sink = 0;
+        for (int i = 0; i < 10000; i++) sink += i;
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    stop = true;
+    ticker.join();
+    std::vector<profile::Stat> stats = profile::stats();
+    bool followed = false;
+    for (const profile::Stat &s : stats) followed |= strcmp(s.name, "ticked") == 0 && s.avg > 0;
+
+    char path[] = "/tmp/raycraft-trace-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) close(fd);
+    t0 = bench_clock::now();
+    bool dumped = fd >= 0 && profile::dump(path, frames);
+    double dump = seconds_since(t0);
+    struct stat st;
+    size_t bytes = dumped && stat(path, &st) == 0 ? st.st_size : 0;
+    unlink(path);
+
+    Record r("profile");
+    r.add("enabled", PROFILE_ENABLED != 0).add("scope_ns", per * 1e9).add("stages", stats.size()).add("followed", followed)
+     .add("frame_avg_ms", stats.empty() ? 0.0f : stats[0].avg).add("dumped", dumped)
+     .add("dump_ms", dump * 1e3).add("dump_bytes", bytes);
+    emit(r);
+}
+
+// the job pool under contention: tiny jobs of every priority from the main thread, from other threads and
+// from inside jobs, run() batches in between, and a channel cancelled half way
+// NOTE: `ok` checks every job ran once and its done once, that cancelled jobs either ran or were dropped, and
+// that every small run() batch ran all of its items before returning
+void bench_jobs(int count) {
+    jobs::Pool pool;
+    int channels[jobs::PRIORITIES] = {pool.channel("near"), pool.channel("normal"), pool.channel("far"), pool.channel("background")};
+    int batch_channel = pool.channel("batch"), cancel_channel = pool.channel("cancel");
+    const int submitters = 4;  // the main thread and three others
+
+    // every submitted job gets two slots, its own and one for a job it may submit itself
+    int slots = submitters * count * 2;
+    std::vector<std::atomic<int>> ran(slots), done(slots);
+    std::vector<char> submitted(slots, 0);
+    std::atomic<long long> sink{0};
+    auto spin = [&sink](int id) {
+        unsigned h = id;
+        for (int i = 0; i < 200; i++) h = h * 1664525u + 1013904223u;
+        sink += h & 1;
+    };
+    auto job = [&](int id, bool nested) {
+        submitted[id] = 1;
+        pool.submit(channels[id / 2 % jobs::PRIORITIES], id / 2 % jobs::PRIORITIES, [&, id, nested]() {
+            ran[id]++;
+            spin(id);
+            if (nested) pool.submit(channels[jobs::Near], jobs::Near, [&, id]() { ran[id + 1]++; spin(id); }, [&, id]() { done[id + 1]++; });
+        }, [&, id]() { done[id]++; });
+        if (nested) submitted[id + 1] = 1;
+    };
+    auto submit_all = [&](int s) {
+        for (int j = 0; j < count; j++) {
+            int id = (s * count + j) * 2;
+            job(id, j % 3 == 0);
+        }
+    };
+
+    std::atomic<int> cancel_ran{0};
+    int cancel_count = count / 4, dropped = 0, batch_wrong = 0, batches = 0;
+    std::vector<int> hits(256);
+
+    auto t0 = bench_clock::now();
+    std::vector<std::thread> others;
+    for (int s = 1; s < submitters; s++) others.emplace_back(submit_all, s);
+    for (int j = 0; j < count; j++) {
+        job(j * 2, j % 3 == 0);
+        if (j % (count / 8) == 0) {
+            std::fill(hits.begin(), hits.end(), 0);
+            pool.run(batch_channel, (int)hits.size(), [&hits](int i) { hits[i]++; });
+            for (int h : hits) batch_wrong += h != 1;
+            batches++;
+        }
+        if (j == count / 2) {
+            for (int k = 0; k < cancel_count; k++) pool.submit(cancel_channel, jobs::Background, [&cancel_ran]() { cancel_ran++; });
+            dropped = pool.cancel(cancel_channel);
+        }
+        if (j % 64 == 0) pool.complete(INFINITY);
+    }
+    for (auto &t : others) t.join();
+    pool.wait();
+    pool.complete(INFINITY);
+    double secs = seconds_since(t0);
+
+    // many tiny run() batches back to back, each returning as its last job finishes (run it under -fsanitize=thread
+    // or address: the batch lives on this stack and has to outlive every job of it), with a few workers even on one core
+    jobs::Pool small(std::max(pool.workers(), 3));
+    const int runs = count;
+    int run_wrong = 0;
+    std::atomic<int> ran_in_run{0};
+    t0 = bench_clock::now();
+    for (int k = 0; k < runs; k++) {
+        int n = 1 + k % 8;
+        ran_in_run = 0;
+        small.run(small.channel("run"), n, [&ran_in_run](int) { ran_in_run++; });
+        run_wrong += ran_in_run != n;
+    }
+    double run_us = seconds_since(t0) / runs * 1e6;
+
+    long long total = 0, lost = 0, twice = 0, stolen = 0;
+    for (int i = 0; i < slots; i++) {
+        if (!submitted[i]) continue;
+        total++;
+        lost += ran[i] == 0 || done[i] == 0;
+        twice += ran[i] > 1 || done[i] > 1;
+    }
+    double wait_max = 0;
+    for (int ch : channels) {
+        stolen += pool.stats(ch).stolen;
+        wait_max = std::max(wait_max, pool.stats(ch).wait_max);
+    }
+    bool ok = lost == 0 && twice == 0 && batch_wrong == 0 && run_wrong == 0 && cancel_ran + dropped == cancel_count;
+
+    Record r("jobs");
+    r.add("workers", pool.workers()).add("submitters", submitters).add("jobs", total).add("jobs_s", total / secs)
+     .add("stolen", stolen).add("lost", lost).add("twice", twice).add("batches", batches).add("batch_wrong", batch_wrong)
+     .add("runs", runs).add("run_wrong", run_wrong).add("run_us", run_us)
+     .add("cancelled", dropped).add("near_wait_ms", pool.stats(channels[jobs::Near]).wait_avg)
+     .add("background_wait_ms", pool.stats(channels[jobs::Background]).wait_avg)
+     .add("wait_max_ms", wait_max).add("ok", ok);
+    emit(r);
+}
+
+// lod tiles: build cost per level, and what the walk draws as the full detail distance grows
+// NOTE: every tile and chunk counts as ready, full_est is the triangles of full detail chunks out to the horizon
+void bench_lod(float horizon) {
+    world::Terrain t = bench_terrain();
+    mesher::ChunkMesh cm;
+    std::unordered_map<long long, int> tile_triangles;
+    for (int level = 1; level <= lod::LEVELS; level++) {
+        const int tiles = 16;
+        size_t quads = 0;
+        auto t0 = bench_clock::now();
+        for (int i = 0; i < tiles; i++) {
+            lod::build(t, level, i % 4, i / 4, cm);
+            quads += cm.quads.size();
+            tile_triangles[lod::key(level, i % 4, i / 4)] = cm.triangle_count();
+        }
+        Record r("lod_build");
+        r.add("level", level).add("tile_blocks", lod::span(level)).add("build_us", seconds_since(t0) / tiles * 1e6)
+         .add("quads_per_tile", (double)quads / tiles);
+        emit(r);
+    }
+
+    world::ColumnCache cache;
+    t.cache = &cache;
+    world::World w;
+    std::unordered_map<long long, int> chunk_triangles;
+    auto chunk = [&](int cx, int cz) {
+        long long k = world::key(cx, cz);
+        auto it = chunk_triangles.find(k);
+        if (it != chunk_triangles.end()) return it->second;
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                if (w.chunk(cx + dx, cz + dz)) continue;
+                world::Chunk *c = w.touch(cx + dx, cz + dz);
+                world::generate(*c, t);
+            }
+        }
+        mesher::build(w, cx, cz, cm);
+        return chunk_triangles[k] = cm.triangle_count();
+    };
+    auto tile = [&](int level, int tx, int tz) {
+        long long k = lod::key(level, tx, tz);
+        auto it = tile_triangles.find(k);
+        if (it != tile_triangles.end()) return it->second;
+        lod::build(t, level, tx, tz, cm);
+        return tile_triangles[k] = cm.triangle_count();
+    };
+
+    for (int near : {16, 32, 64, 96}) {
+        size_t leaves[lod::LEVELS + 1] = {0}, triangles = 0, chunk_total = 0;
+        bool count = true;
+        lod::Walk walk;
+        walk.ready = [](int, int, int) { return true; };
+        walk.want = [](int, int, int) {};
+        walk.leaf = [&](int level, int tx, int tz) {
+            if (!count) return;
+            leaves[level]++;
+            int n = level ? tile(level, tx, tz) : chunk(tx, tz);
+            triangles += n;
+            if (!level) chunk_total += n;
+        };
+        walk.run(8.5f, 8.5f, near, horizon);
+        count = false;
+        auto t0 = bench_clock::now();
+        const int walks = 100;
+        for (int i = 0; i < walks; i++) walk.run(8.5f, 8.5f, near, horizon);
+        double per = seconds_since(t0) / walks;
+
+        double chunks_in_horizon = 3.14159265 * horizon * horizon / (world::CHUNK_SIZE * world::CHUNK_SIZE);
+        Record r("lod");
+        r.add("near", near).add("horizon", horizon).add("chunks", leaves[0]).add("tiles_2x", leaves[1]).add("tiles_4x", leaves[2])
+         .add("tiles_8x", leaves[3]).add("triangles", triangles).add("full_est", (size_t)(chunk_total / std::max<size_t>(leaves[0], 1) * chunks_in_horizon))
+         .add("walk_us", per * 1e6);
+        emit(r);
+    }
+}
+
+// the visibility graph: what connecting the sections costs per chunk, and what the walk leaves to draw out of
+// what a view cone (standing in for the frustum) would, on the surface and from a room and a tunnel dug underground
+void bench_occlusion(int radius) {
+    const int size = (2 * radius + 2) * world::CHUNK_SIZE, mid = radius + 1;
+    world::World w;
+    world::populate(w, bench_terrain(), size);
+
+    std::unordered_map<long long, mesher::ChunkMesh> meshes;
+    auto mesh_all = [&]() {
+        for (const auto &it : w.chunks) mesher::build(w, it.second->cx, it.second->cz, meshes[it.first]);
+    };
+    mesh_all();
+    occlusion::Graph g;
+    auto t0 = bench_clock::now();
+    for (const auto &it : w.chunks) occlusion::connect(*it.second, g);
+    double connect = seconds_since(t0) / w.chunks.size();
+    t0 = bench_clock::now();
+    mesh_all();
+    double build = seconds_since(t0) / w.chunks.size();
+    Record r("occlusion_graph");
+    r.add("chunks", w.chunks.size()).add("connect_us", connect * 1e6).add("mesh_us", build * 1e6);
+    emit(r);
+
+    auto dig = [&](int x0, int y0, int z0, int x1, int y1, int z1) {
+        for (int x = x0; x <= x1; x++)
+            for (int y = y0; y <= y1; y++)
+                for (int z = z0; z <= z1; z++) w.set(x, y, z, Air);
+        mesh_all();
+    };
+
+    const int c = mid * world::CHUNK_SIZE + world::CHUNK_SIZE / 2;
+    struct View {
+        const char *name;
+        float eye[3], dir[3];
+    };
+    for (const char *name : {"surface", "room", "tunnel"}) {
+        View v {name, {c + 0.5f, w.top(c, c) + (float)sim::CAM_HEIGHT, c + 0.5f}, {1, -0.2f, 0.3f}};
+        if (!strcmp(name, "room")) {
+            dig(c - 3, 0, c - 3, c + 3, 3, c + 3);
+            v.eye[1] = 2.5f;
+        } else if (!strcmp(name, "tunnel")) {
+            dig(0, 1, c - 1, size - 1, 3, c + 1);
+            v.eye[1] = 2.5f;
+            v.dir[1] = v.dir[2] = 0;
+        }
+        float l = sqrtf(v.dir[0] * v.dir[0] + v.dir[1] * v.dir[1] + v.dir[2] * v.dir[2]);
+        for (float &d : v.dir) d /= l;
+
+        // a 50 degree cone around the view direction, widened by the section's bounding sphere
+        auto inside = [&](int cx, int s, int cz) {
+            float o[3] = {(cx + 0.5f) * world::CHUNK_SIZE - v.eye[0], (s + 0.5f) * occlusion::SECTION - v.eye[1], (cz + 0.5f) * world::CHUNK_SIZE - v.eye[2]};
+            float d = sqrtf(o[0] * o[0] + o[1] * o[1] + o[2] * o[2]), reach = 0.87f * occlusion::SECTION;
+            if (d <= reach) return true;
+            return (o[0] * v.dir[0] + o[1] * v.dir[1] + o[2] * v.dir[2]) / d >= cosf(std::min(0.87f + asinf(reach / d), 3.14159265f));
+        };
+        occlusion::Walk walk;
+        walk.graph = [&](int cx, int cz) -> const occlusion::Graph * {
+            auto it = meshes.find(world::key(cx, cz));
+            return it == meshes.end() ? nullptr : &it->second.graph;
+        };
+        walk.inside = inside;
+        unsigned char start = occlusion::pocket(w, (int)floorf(v.eye[0]), (int)floorf(v.eye[1]), (int)floorf(v.eye[2]));
+        walk.run(v.eye[0], v.eye[1], v.eye[2], radius, start);
+
+        size_t in_view = 0, reached = 0, in_view_triangles = 0, reached_triangles = 0;
+        for (int cx = walk.cx - radius; cx <= walk.cx + radius; cx++) {
+            for (int cz = walk.cz - radius; cz <= walk.cz + radius; cz++) {
+                bool any = false;
+                for (int s = 0; s < occlusion::SECTIONS; s++) any = any || inside(cx, s, cz);
+                if (!any) continue;
+                int n = meshes.at(world::key(cx, cz)).triangle_count();
+                in_view++;
+                in_view_triangles += n;
+                if (walk.reached(cx, cz)) {
+                    reached++;
+                    reached_triangles += n;
+                }
+            }
+        }
+        const int walks = 200;
+        t0 = bench_clock::now();
+        for (int i = 0; i < walks; i++) walk.run(v.eye[0], v.eye[1], v.eye[2], radius, start);
+
+        Record rec("occlusion");
+        rec.add("view", name).add("radius", radius).add("chunks_in_view", in_view).add("chunks_reached", reached)
+           .add("triangles_in_view", in_view_triangles).add("triangles_reached", reached_triangles)
+           .add("sections_visited", walk.visited).add("walk_us", seconds_since(t0) / walks * 1e6);
+        emit(rec);
+    }
+}
+
+// the CPU renderer over a populated map, looking down from past a corner and standing in the middle
+// NOTE: `same` checks every thread count draws the very same pixels as one thread
+void bench_render(int size, int frames) {
+    world::World w;
+    world::populate(w, bench_terrain(), size);
+    render::Textures tex;
+    tex.load(render::RESOURCES);
+
+    const char *names[2] = {"overview", "ground"};
+    render::View views[2];
+    float mid = size / 2.0f, ground = w.top(size / 2, size / 2) + sim::CAM_HEIGHT;
+    views[0].position[0] = views[0].position[2] = -20;
+    views[0].position[1] = 90;
+    views[0].target[0] = views[0].target[2] = mid;
+    views[0].target[1] = 20;
+    views[0].far = 2.0f * size;
+    views[1].position[0] = views[1].position[2] = mid + 0.5f;
+    views[1].position[1] = ground;
+    views[1].target[0] = mid + 30;
+    views[1].target[1] = ground - 4;
+    views[1].target[2] = mid + 15;
+
+    const int width = 320, height = 240;
+    int cores = std::thread::hardware_concurrency();
+    std::vector<int> workers = {0};
+    if (cores > 1) workers.push_back(cores - 1);
+    for (int v = 0; v < 2; v++) {
+        unsigned long long first = 0;
+        for (int n : workers) {
+            jobs::Pool pool(n);
+            render::Renderer r(pool);
+            r.draw(w, views[v], tex, width, height);
+            auto t0 = bench_clock::now();
+            for (int f = 0; f < frames; f++) r.draw(w, views[v], tex, width, height);
+            double per = seconds_since(t0) / frames;
+
+            unsigned long long hash = 1469598103934665603ull;
+            for (unsigned char b : r.frame.rgba) hash = (hash ^ b) * 1099511628211ull;
+            if (n == 0) first = hash;
+            char hex[32];
+            snprintf(hex, sizeof(hex), "%016llx", hash);
+
+            Record rec("render");
+            rec.add("view", names[v]).add("size", size).add("threads", r.threads()).add("width", width).add("height", height)
+               .add("frame_ms", per * 1e3).add("fps", 1 / per).add("mrays_s", r.rays / per / 1e6).add("msteps_s", r.steps / per / 1e6)
+               .add("steps_per_ray", (double)r.steps / r.rays).add("stolen", r.stolen).add("textures", tex.loaded)
+               .add("hash", (const char *)hex).add("same", hash == first);
+            emit(rec);
+        }
+    }
+}
+
+// a map preview png, the overview of bench_render at 1280x720
+bool bench_preview(const char *path, int size) {
+    world::World w;
+    world::populate(w, bench_terrain(), size);
+    render::Textures tex;
+    tex.load(render::RESOURCES);
+    render::View v;
+    v.position[0] = v.position[2] = -size / 10.0f;
+    v.position[1] = 90;
+    v.target[0] = v.target[2] = size / 2.0f;
+    v.target[1] = 20;
+    v.far = 2.0f * size;
+
+    jobs::Pool pool;
+    render::Renderer r(pool);
+    auto t0 = bench_clock::now();
+    r.draw(w, v, tex, 1280, 720);
+    double draw = seconds_since(t0);
+    bool saved = png::save(path, r.frame);
+    Record rec("preview");
+    rec.add("size", size).add("threads", r.threads()).add("frame_ms", draw * 1e3).add("textures", tex.loaded).add("saved", saved);
+    emit(rec);
+    if (!saved) fprintf(stderr, "can't write %s\n", path);
+    return saved;
+}
+
+// ms the workers spent in scopes called `name` since `since` (ns on the profiler clock), 0 without the profiler
+double worker_ms(const char *name, long long since) {
+    double ms = 0;
+#if PROFILE_ENABLED
+    std::vector<profile::Ring *> all;
+    {
+        std::lock_guard<std::mutex> guard(profile::registry);
+        for (auto &r : profile::rings) all.push_back(r.get());
+    }
+    std::vector<profile::Event> events;
+    for (profile::Ring *r : all) {
+        if (strcmp(r->thread, "jobs")) continue;
+        events.clear();
+        profile::copy(*r, since, events);
+        for (const profile::Event &e : events)
+            if (!strcmp(e.name, name)) ms += (e.end - e.start) / 1e6;
+    }
+#else
+    (void)name;
+    (void)since;
+#endif
+    return ms;
+}
+
+// a recorded session through the same steps as the game, without a window, streaming settled every frame
+// NOTE: every run of a log has to end in the same place with the same blocks, `same` checks that against the first run
+bool bench_replay(const char *path, int runs) {
+    input::Log log;
+    if (!log.load(path) || log.frames.empty()) {
+        fprintf(stderr, "can't read input log %s, or it was recorded by an older version\n", path);
+        return false;
+    }
+
+    unsigned long long first_hash = 0;
+    for (int run = 0; run < runs; run++) {
+        world::ColumnCache cache;
+        sim::Game game;
+        game.terrain = bench_terrain(log.header.seed);
+        game.terrain.cache = &cache;
+        jobs::Pool pool;
+        stream::Streamer streamer(pool, &game.terrain, 8);
+        game.load_spawn(streamer, nullptr);
+
+#if PROFILE_ENABLED
+        long long since = profile::now();
+#else
+        long long since = 0;
+#endif
+        size_t meshes = 0, remeshed = 0;
+        double stream = 0, remesh = 0;
+        std::vector<double> steps;
+        steps.reserve(log.frames.size());
+        mesher::ChunkMesh cm;
+        for (input::Input in : log.frames) {
+            in.dt = input::FIXED_DT;
+            auto t0 = bench_clock::now();
+            streamer.settle(game.level, game.chunk_x(), game.chunk_z(), [](int, int) {},
+                            [&](const mesher::ChunkMesh &) { meshes++; });
+            stream += seconds_since(t0);
+
+            t0 = bench_clock::now();
+            game.step(in);
+            steps.push_back(seconds_since(t0));
+
+            // what the game uploads again after a click
+            t0 = bench_clock::now();
+            for (long long k : game.edited) {
+                auto it = game.level.chunks.find(k);
+                if (it != game.level.chunks.end()) mesher::build(game.level, it->second->cx, it->second->cz, cm);
+            }
+            remesh += seconds_since(t0);
+            remeshed += game.edited.size();
+            game.edited.clear();
+        }
+
+        size_t n = steps.size();
+        double total = 0;
+        for (double t : steps) total += t;
+        std::sort(steps.begin(), steps.end());
+        unsigned long long hash = world_hash(game.level);
+        if (run == 0) first_hash = hash;
+
+        char hex[32];
+        snprintf(hex, sizeof(hex), "%016llx", hash);
+        const sim::Player &p = game.player;
+        Record r("replay");
+        r.add("run", run).add("frames", n).add("seed", log.header.seed).add("sim_s", game.time)
+         .add("step_avg_us", total / n * 1e6).add("step_p99_us", steps[std::min(n - 1, (size_t)(n * 0.99))] * 1e6)
+         .add("stream_avg_ms", stream / n * 1e3).add("meshes", meshes)
+         .add("mesh_ms", worker_ms("mesh", since)).add("generate_ms", worker_ms("generate", since))
+         .add("remeshed", remeshed).add("remesh_avg_us", remeshed ? remesh / remeshed * 1e6 : 0.0)
+         .add("x", p.position[0]).add("y", p.position[1]).add("z", p.position[2])
+         .add("chunks", game.level.chunks.size()).add("hash", (const char *)hex).add("same", hash == first_hash);
+        emit(r);
+    }
+    return true;
+}
+
+// randomized walks, jumps, clicks and flights over a map strewn with pillars, walls, pits and overhangs, and now and
+// then blocks dropped right onto the player
+// NOTE: `ok` checks the player's box never overlapped a solid block after a step, outside free observe and off the map
+void bench_collide(int sequences, int steps) {
+    const int size = 96;
+    sim::Game game;
+    world::populate(game.level, bench_terrain(), size);
+    world::World &w = game.level;
+    unsigned rng = 777;
+    auto next = [&rng](int n) {
+        rng = rng * 1664525u + 1013904223u;
+        return (int)((rng >> 8) % n);
+    };
+    for (int i = 0; i < size * size / 24; i++) {
+        int x = 2 + next(size - 4), z = 2 + next(size - 4), top = w.top(x, z), kind = next(4);
+        if (kind == 0) {
+            for (int y = top + 1, h = 1 + next(4); y <= top + h; y++) w.set(x, y, z, Dirt);
+        } else if (kind == 1) {
+            for (int k = 0; k < 5; k++)
+                for (int y = top + 1; y <= top + 2; y++) w.set(x + k, y, z, Stone);
+        } else if (kind == 2) {
+            for (int y = top; y > std::max(top - 4, 0); y--) w.set(x, y, z, Air);
+        } else {
+            for (int dx = 0; dx < 3; dx++)
+                for (int dz = 0; dz < 3; dz++) w.set(x + dx, top + 4, z + dz, Dirt);
+        }
+    }
+
+    size_t total = 0, inside = 0, stepped_up = 0, airborne = 0, dropped = 0, floating = 0;
+    long long lookups = 0;
+    int lookups_max = 0;
+    float lowest = INFINITY;
+    auto t0 = bench_clock::now();
+    for (int s = 0; s < sequences; s++) {
+        sim::Player &p = game.player;
+        p = sim::Player();
+        p.position[0] = 4 + next(size - 8) + 0.5f;
+        p.position[2] = 4 + next(size - 8) + 0.5f;
+        p.position[1] = w.top((int)p.position[0], (int)p.position[2]) + sim::CAM_HEIGHT;
+        p.angle[0] = next(628) / 100.0f;
+        p.target_distance = 10;
+        input::Input in;
+        in.dt = input::FIXED_DT;
+        for (int i = 0; i < steps; i++) {
+            if (i % 15 == 0) in.down = next(1 << 6);  // walking and Slow
+            in.pressed = 0;
+            if (next(20) == 0) in.pressed |= input::Jump;
+            if (next(60) == 0) in.pressed |= next(2) ? input::Place : input::Break;
+            if (next(400) == 0) in.pressed |= input::FreeObserve;
+            in.mouse[0] = next(41) - 20;
+            in.mouse[1] = next(21) - 10;
+            if (next(300) == 0) {
+                // what a fill or a paste can do
+                collide::Body b = p.body();
+                for (int y = (int)b.min(1); y <= (int)b.max(1); y++) w.set((int)floorf(p.position[0]), y, (int)floorf(p.position[2]), Dirt);
+                dropped++;
+            }
+            float y0 = p.position[1];
+            game.step(in);
+            total++;
+            // flown out over the edge of the map, where nothing is loaded
+            floating += !p.free_observe && !game.ground_loaded;
+            if (p.free_observe || !game.ground_loaded) continue;
+            collide::Body b = p.body();
+            inside += collide::inside(w, b);
+            stepped_up += p.grounded && p.position[1] - y0 > 0.5f;
+            airborne += !p.grounded;
+            lookups += game.lookups;
+            lookups_max = std::max(lookups_max, game.lookups);
+            lowest = std::min(lowest, b.position[1]);
+        }
+        game.edits.edits.clear();
+    }
+    double secs = seconds_since(t0);
+
+    Record r("collide");
+    r.add("sequences", sequences).add("steps", total).add("inside", inside).add("stepped_up", stepped_up)
+     .add("airborne", airborne).add("floating", floating).add("dropped_on", dropped).add("lowest_floor", lowest)
+     .add("lookups_avg", (double)lookups / total).add("lookups_max", lookups_max).add("step_us", secs / total * 1e6)
+     .add("ok", inside == 0 && lowest >= 0);
+    emit(r);
+}
+
+// the tick thread against frames that take anywhere from 5 to 60 ms, a frame pushes its input and sleeps the rest
+// NOTE: the tick rate and the input latency should not move with the frame time, `tick_hz` against 1 / FIXED_DT
+void bench_tick(double seconds) {
+    world::ColumnCache cache;
+    sim::Game game;
+    game.terrain = bench_terrain();
+    game.terrain.cache = &cache;
+    jobs::Pool pool;
+    stream::Streamer streamer(pool, &game.terrain, 6);
+    game.load_spawn(streamer, nullptr);
+
+    tick::Runner runner(game, streamer);
+    tick::State a, b;
+    std::vector<tick::Update> updates;
+    size_t frames = 0, uploads = 0, first = 0;
+    unsigned rng = 12345;
+    runner.start();
+    auto t0 = bench_clock::now();
+    while (seconds_since(t0) < seconds) {
+        input::Input in;
+        in.down = input::Forward;
+        in.mouse[0] = 2;
+        runner.push(in);
+        runner.take(a, b, updates);
+        if (!frames) first = b.tick;
+        uploads += updates.size();
+        updates.clear();
+        frames++;
+        rng = rng * 1664525u + 1013904223u;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5 + (rng >> 16) % 56));
+    }
+    double secs = seconds_since(t0);
+    runner.stop();
+    runner.take(a, b, updates);
+
+    Record r("tick");
+    r.add("seconds", secs).add("frames", frames).add("frame_hz", frames / secs).add("ticks", b.tick - first)
+     .add("tick_hz", (b.tick - first) / secs).add("target_hz", 1 / input::FIXED_DT).add("late", runner.late)
+     .add("input_last_ms", b.input_ms).add("input_max_ms", runner.input_max_ms).add("inputs", runner.inputs)
+     .add("uploads", uploads + updates.size()).add("chunks", b.chunks);
+    emit(r);
+}
+
+int main(int argc, char **argv) {
+    // --quick runs the small sizes and one seed, for a check between versions
+    // --budget N, the old flat list paths are skipped above N blocks (40 bytes each)
+    // --replay file, only replays a recorded session (twice, to check it is deterministic)
+    // --render file, only draws a preview of the 250 map with the CPU renderer
+    bool quick = false;
+    size_t old_budget = 8000000;
+    const char *replay = nullptr, *preview = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quick")) quick = true;
+        else if (!strcmp(argv[i], "--budget") && i + 1 < argc) old_budget = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc) replay = argv[++i];
+        else if (!strcmp(argv[i], "--render") && i + 1 < argc) preview = argv[++i];
+        else { fprintf(stderr, "usage: %s [--quick] [--budget blocks] [--replay file] [--render file]\n", argv[0]); return 1; }
+    }
+
+    if (replay) {
+        if (!bench_replay(replay, 2)) return 1;
+    } else if (preview) {
+        if (!bench_preview(preview, 250)) return 1;
+    } else {
+        std::vector<int> seeds = {perlin::SEED};
+        if (!quick) seeds.insert(seeds.end(), {1, 1234});
+        for (int seed : seeds)
+            for (int size : {250, 1000}) bench_map(size, seed, old_budget);
+        if (!quick) bench_map(4000, perlin::SEED, old_budget);
+
+        bench_startup(1000);
+        if (!quick) bench_startup(2000);
+        for (int octaves : {1, 4}) bench_noise(octaves);
+        bench_cache(1000);
+        bench_caves(1000);
+        bench_stream(quick ? 120 : 600);
+        bench_region(1000);
+        for (int size : {250, 1000}) bench_edit(size, old_budget);
+        bench_light(250);
+        bench_bulk(250, 128);
+        bench_profile();
+        bench_jobs(quick ? 20000 : 100000);
+        bench_collide(quick ? 1000 : 5000, 200);
+        bench_tick(quick ? 2 : 6);
+        bench_lod(512);
+        bench_occlusion(8);
+        bench_render(250, quick ? 3 : 10);
+    }
+
+    printf("{\n  \"suite\": \"raycraft\",\n  \"quick\": %s,\n  \"cores\": %u,\n  \"noise_kernel\": \"%s\",\n  \"results\": [\n",
+           quick ? "true" : "false", std::thread::hardware_concurrency(), perlin::kernel().name);
+    for (size_t i = 0; i < results.size(); i++) printf("    %s%s\n", results[i].c_str(), i + 1 < results.size() ? "," : "");
+    printf("  ]\n}\n");
+    return 0;
+}
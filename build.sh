@@ -1,4 +1,5 @@
-g++ ./main.cpp -std=c++17 -o ./raycraft.out -L./raylib/lib/ -lraylib
+g++ ./main.cpp -std=c++17 -pthread -o ./raycraft.out -L./raylib/lib/ -lraylib
+g++ ./bench.cpp -std=c++17 -O2 -pthread -o ./bench.out
 LD_LIBRARY_PATH=./raylib/lib/
 export LD_LIBRARY_PATH
 ./raycraft.out
\ No newline at end of file
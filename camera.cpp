@@ -1,6 +1,7 @@
 // Custom first-person camera handling
 #include <cmath>
 #include "raylib/include/raylib.h"
+#include "raylib/include/raymath.h"
 
 //----------------------------------------------------------------------------------
 // Defines and Macros
@@ -123,131 +124,54 @@ void EnableFirstPerson(Camera camera/*, int mode*/)
     CAMERA.mode = CAMERA_FIRST_PERSON;
 }
 
+// NOTE: first person movement and look are in sim::Player (sim.cpp), without raylib so replays run them headless
+
+//----------------------------------------------------------------------------------
+// View frustum
+//----------------------------------------------------------------------------------
+// Must match the clip planes BeginMode3D() uses
+#define CAMERA_CULL_DISTANCE_NEAR 0.01
+#define CAMERA_CULL_DISTANCE_FAR 1000.0
+
+// Six planes (a, b, c, d) facing inwards: left, right, bottom, top, near, far
+typedef struct
+{
+	Vector4 planes[6];
+} Frustum;
+
 // CUSTOM handle
-void FirstPersonCamera(Camera *camera, bool force_eyedist = false, float mv_sensivity = 25.f)
+Frustum CameraFrustum(Camera camera, float aspect)
 {
-	int swingCounter = 0; // Used for 1st person swinging movement
-
-	// TODO: Compute CAMERA.targetDistance and CAMERA.angle here (?)
-
-	// Mouse movement detection
-	Vector2 mousePositionDelta = {0.0f, 0.0f};
-	Vector2 mousePosition = GetMousePosition();
-	float mouseWheelMove = GetMouseWheelMove();
-
-	// Keys input detection
-	// TODO: Input detection is raylib-dependant, it could be moved outside the module
-	bool keyPan = IsMouseButtonDown(CAMERA.panControl);
-	bool keyAlt = IsKeyDown(CAMERA.altControl);
-	bool szoomKey = IsKeyDown(CAMERA.smoothZoomControl);
-	bool direction[6] = {IsKeyDown(CAMERA.moveControl[MOVE_FRONT]),
-						 IsKeyDown(CAMERA.moveControl[MOVE_BACK]),
-						 IsKeyDown(CAMERA.moveControl[MOVE_RIGHT]),
-						 IsKeyDown(CAMERA.moveControl[MOVE_LEFT]),
-						 // these two are reserved for jump action
-						 /*IsKeyDown(CAMERA.moveControl[MOVE_UP])*/ false,
-						 /*IsKeyDown(CAMERA.moveControl[MOVE_DOWN])*/ false};
-
-	// commented this and the app stopped working :)
-	if (CAMERA.mode != CAMERA_CUSTOM)
+	Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+	Matrix proj = MatrixPerspective(camera.fovy * DEG2RAD, aspect, CAMERA_CULL_DISTANCE_NEAR, CAMERA_CULL_DISTANCE_FAR);
+	Matrix m = MatrixMultiply(view, proj);
+
+	// Planes from the rows of the view-projection matrix (Gribb/Hartmann)
+	Vector4 row[4] = {{m.m0, m.m4, m.m8, m.m12},
+					  {m.m1, m.m5, m.m9, m.m13},
+					  {m.m2, m.m6, m.m10, m.m14},
+					  {m.m3, m.m7, m.m11, m.m15}};
+
+	Frustum frustum;
+	for (int i = 0; i < 3; i++)
 	{
-		mousePositionDelta.x = mousePosition.x - CAMERA.previousMousePosition.x;
-		mousePositionDelta.y = mousePosition.y - CAMERA.previousMousePosition.y;
-	
-		CAMERA.previousMousePosition = mousePosition;
+		frustum.planes[i * 2] = {row[3].x + row[i].x, row[3].y + row[i].y, row[3].z + row[i].z, row[3].w + row[i].w};
+		frustum.planes[i * 2 + 1] = {row[3].x - row[i].x, row[3].y - row[i].y, row[3].z - row[i].z, row[3].w - row[i].w};
 	}
+	return frustum;
+}
 
-	camera->position.x += (sinf(CAMERA.angle.x) * direction[MOVE_BACK] -
-						   sinf(CAMERA.angle.x) * direction[MOVE_FRONT] -
-						   cosf(CAMERA.angle.x) * direction[MOVE_LEFT] +
-						   cosf(CAMERA.angle.x) * direction[MOVE_RIGHT]) /
-						  mv_sensivity;
-
-	camera->position.y += (sinf(CAMERA.angle.y) * direction[MOVE_FRONT] -
-						   sinf(CAMERA.angle.y) * direction[MOVE_BACK] +
-						   1.0f * direction[MOVE_UP] - 1.0f * direction[MOVE_DOWN]) /
-						  mv_sensivity;
-
-	camera->position.z += (cosf(CAMERA.angle.x) * direction[MOVE_BACK] -
-						   cosf(CAMERA.angle.x) * direction[MOVE_FRONT] +
-						   sinf(CAMERA.angle.x) * direction[MOVE_LEFT] -
-						   sinf(CAMERA.angle.x) * direction[MOVE_RIGHT]) /
-						  mv_sensivity;
-
-	// Camera orientation calculation
-	CAMERA.angle.x += (mousePositionDelta.x * -CAMERA_MOUSE_MOVE_SENSITIVITY);
-	CAMERA.angle.y += (mousePositionDelta.y * -CAMERA_MOUSE_MOVE_SENSITIVITY);
-
-	// Angle clamp
-	if (CAMERA.angle.y > CAMERA_FIRST_PERSON_MIN_CLAMP * DEG2RAD)
-		CAMERA.angle.y = CAMERA_FIRST_PERSON_MIN_CLAMP * DEG2RAD;
-	else if (CAMERA.angle.y < CAMERA_FIRST_PERSON_MAX_CLAMP * DEG2RAD)
-		CAMERA.angle.y = CAMERA_FIRST_PERSON_MAX_CLAMP * DEG2RAD;
-
-	// Calculate translation matrix
-	Matrix matTranslation = {1.0f, 0.0f, 0.0f, 0.0f,
-							 0.0f, 1.0f, 0.0f, 0.0f,
-							 0.0f, 0.0f, 1.0f, (CAMERA.targetDistance / CAMERA_FREE_PANNING_DIVIDER),
-							 0.0f, 0.0f, 0.0f, 1.0f};
-
-	// Calculate rotation matrix
-	Matrix matRotation = {1.0f, 0.0f, 0.0f, 0.0f,
-						  0.0f, 1.0f, 0.0f, 0.0f,
-						  0.0f, 0.0f, 1.0f, 0.0f,
-						  0.0f, 0.0f, 0.0f, 1.0f};
-
-	float cosz = cosf(0.0f);
-	float sinz = sinf(0.0f);
-	float cosy = cosf(-(PI * 2 - CAMERA.angle.x));
-	float siny = sinf(-(PI * 2 - CAMERA.angle.x));
-	float cosx = cosf(-(PI * 2 - CAMERA.angle.y));
-	float sinx = sinf(-(PI * 2 - CAMERA.angle.y));
-
-	matRotation.m0 = cosz * cosy;
-	matRotation.m4 = (cosz * siny * sinx) - (sinz * cosx);
-	matRotation.m8 = (cosz * siny * cosx) + (sinz * sinx);
-	matRotation.m1 = sinz * cosy;
-	matRotation.m5 = (sinz * siny * sinx) + (cosz * cosx);
-	matRotation.m9 = (sinz * siny * cosx) - (cosz * sinx);
-	matRotation.m2 = -siny;
-	matRotation.m6 = cosy * sinx;
-	matRotation.m10 = cosy * cosx;
-
-	// Multiply translation and rotation matrices
-	Matrix matTransform = {0};
-	matTransform.m0 = matTranslation.m0 * matRotation.m0 + matTranslation.m1 * matRotation.m4 + matTranslation.m2 * matRotation.m8 + matTranslation.m3 * matRotation.m12;
-	matTransform.m1 = matTranslation.m0 * matRotation.m1 + matTranslation.m1 * matRotation.m5 + matTranslation.m2 * matRotation.m9 + matTranslation.m3 * matRotation.m13;
-	matTransform.m2 = matTranslation.m0 * matRotation.m2 + matTranslation.m1 * matRotation.m6 + matTranslation.m2 * matRotation.m10 + matTranslation.m3 * matRotation.m14;
-	matTransform.m3 = matTranslation.m0 * matRotation.m3 + matTranslation.m1 * matRotation.m7 + matTranslation.m2 * matRotation.m11 + matTranslation.m3 * matRotation.m15;
-	matTransform.m4 = matTranslation.m4 * matRotation.m0 + matTranslation.m5 * matRotation.m4 + matTranslation.m6 * matRotation.m8 + matTranslation.m7 * matRotation.m12;
-	matTransform.m5 = matTranslation.m4 * matRotation.m1 + matTranslation.m5 * matRotation.m5 + matTranslation.m6 * matRotation.m9 + matTranslation.m7 * matRotation.m13;
-	matTransform.m6 = matTranslation.m4 * matRotation.m2 + matTranslation.m5 * matRotation.m6 + matTranslation.m6 * matRotation.m10 + matTranslation.m7 * matRotation.m14;
-	matTransform.m7 = matTranslation.m4 * matRotation.m3 + matTranslation.m5 * matRotation.m7 + matTranslation.m6 * matRotation.m11 + matTranslation.m7 * matRotation.m15;
-	matTransform.m8 = matTranslation.m8 * matRotation.m0 + matTranslation.m9 * matRotation.m4 + matTranslation.m10 * matRotation.m8 + matTranslation.m11 * matRotation.m12;
-	matTransform.m9 = matTranslation.m8 * matRotation.m1 + matTranslation.m9 * matRotation.m5 + matTranslation.m10 * matRotation.m9 + matTranslation.m11 * matRotation.m13;
-	matTransform.m10 = matTranslation.m8 * matRotation.m2 + matTranslation.m9 * matRotation.m6 + matTranslation.m10 * matRotation.m10 + matTranslation.m11 * matRotation.m14;
-	matTransform.m11 = matTranslation.m8 * matRotation.m3 + matTranslation.m9 * matRotation.m7 + matTranslation.m10 * matRotation.m11 + matTranslation.m11 * matRotation.m15;
-	matTransform.m12 = matTranslation.m12 * matRotation.m0 + matTranslation.m13 * matRotation.m4 + matTranslation.m14 * matRotation.m8 + matTranslation.m15 * matRotation.m12;
-	matTransform.m13 = matTranslation.m12 * matRotation.m1 + matTranslation.m13 * matRotation.m5 + matTranslation.m14 * matRotation.m9 + matTranslation.m15 * matRotation.m13;
-	matTransform.m14 = matTranslation.m12 * matRotation.m2 + matTranslation.m13 * matRotation.m6 + matTranslation.m14 * matRotation.m10 + matTranslation.m15 * matRotation.m14;
-	matTransform.m15 = matTranslation.m12 * matRotation.m3 + matTranslation.m13 * matRotation.m7 + matTranslation.m14 * matRotation.m11 + matTranslation.m15 * matRotation.m15;
-
-	camera->target.x = camera->position.x - matTransform.m12;
-	camera->target.y = camera->position.y - matTransform.m13;
-	camera->target.z = camera->position.z - matTransform.m14;
-
-	// If movement detected (some key pressed), increase swinging
-	/*for (int i = 0; i < 6; i++)
-		if (direction[i])
-		{
-			//swingCounter++;
-			break;
-		}*/
-
-	// Camera position update
-	// NOTE: On CAMERA_FIRST_PERSON player Y-movement is limited to player 'eyes position'
-	if(force_eyedist) camera->position.y = CAMERA.playerEyesPosition - sinf(swingCounter / CAMERA_FIRST_PERSON_STEP_TRIGONOMETRIC_DIVIDER) / CAMERA_FIRST_PERSON_STEP_DIVIDER;
-
-	camera->up.x = sinf(swingCounter / (CAMERA_FIRST_PERSON_STEP_TRIGONOMETRIC_DIVIDER * 2)) / CAMERA_FIRST_PERSON_WAVING_DIVIDER;
-	camera->up.z = -sinf(swingCounter / (CAMERA_FIRST_PERSON_STEP_TRIGONOMETRIC_DIVIDER * 2)) / CAMERA_FIRST_PERSON_WAVING_DIVIDER;
+// CUSTOM handle
+// Only the box corner furthest along each plane normal is tested, so this can keep boxes that are just outside a corner
+bool FrustumContainsBox(const Frustum &frustum, BoundingBox box)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		Vector4 p = frustum.planes[i];
+		float x = (p.x >= 0) ? box.max.x : box.min.x;
+		float y = (p.y >= 0) ? box.max.y : box.min.y;
+		float z = (p.z >= 0) ? box.max.z : box.min.z;
+		if (p.x * x + p.y * y + p.z * z + p.w < 0) return false;
+	}
+	return true;
 }
@@ -0,0 +1,132 @@
+// Box against voxel grid collision, a move is swept one axis at a time through the cells it crosses
+// NOTE: only the layers of cells the box's leading face passes are looked at, so a move costs a few dozen
+// lookups however big the world is; unloaded chunks and the underside of the world are solid
+#pragma once
+#include <cmath>
+#include "world.cpp"
+
+namespace collide
+{
+    const float SKIN = 1e-3f;  // gap kept to a face the box stopped at, so it never touches the next cell
+
+    // an upright box, (x, z) the middle of its floor and y the floor itself
+    struct Body {
+        float position[3];
+        float radius, height;  // half the width on x and z, and floor to top
+        int lookups = 0;       // cells looked at since it was last cleared
+
+        float min(int a) const { return a == 1 ? position[1] : position[a] - radius; }
+        float max(int a) const { return a == 1 ? position[1] + height : position[a] + radius; }
+    };
+
+    inline bool blocked(const world::World &w, int x, int y, int z) {
+        if (y < 0) return true;
+        if (y >= world::CHUNK_HEIGHT) return false;
+        const world::Chunk *c = w.chunk(world::chunk_of(x), world::chunk_of(z));
+        return !c || c->get(world::local_of(x), y, world::local_of(z)) != Air;
+    }
+
+    // every chunk the box stands in is there
+    inline bool loaded(const world::World &w, const Body &b) {
+        for (int x : {world::chunk_of((int)floorf(b.min(0))), world::chunk_of((int)floorf(b.max(0)))})
+            for (int z : {world::chunk_of((int)floorf(b.min(2))), world::chunk_of((int)floorf(b.max(2)))})
+                if (!w.chunk(x, z)) return false;
+        return true;
+    }
+
+    // a solid cell anywhere in the layer `cell` of axis `a`, over the cells the box covers on the other two
+    inline bool layer(const world::World &w, Body &b, int a, int cell) {
+        int lo[3], hi[3];
+        for (int k = 0; k < 3; k++) {
+            lo[k] = (int)floorf(b.min(k));
+            hi[k] = (int)floorf(b.max(k));
+        }
+        lo[a] = hi[a] = cell;
+        for (int x = lo[0]; x <= hi[0]; x++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int z = lo[2]; z <= hi[2]; z++) {
+                    b.lookups++;
+                    if (blocked(w, x, y, z)) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // true when the box overlaps a solid cell
+    inline bool inside(const world::World &w, Body &b) {
+        int lo = (int)floorf(b.min(1)), hi = (int)floorf(b.max(1));
+        for (int y = lo; y <= hi; y++)
+            if (layer(w, b, 1, y)) return true;
+        return false;
+    }
+
+    // move along axis `a` by up to `d`, stopping short of the first solid layer; returns how far it went
+    inline float sweep(const world::World &w, Body &b, int a, float d) {
+        if (d == 0) return 0;
+        float lead = d > 0 ? b.max(a) : b.min(a), to = lead + d;
+        if (d > 0) {
+            for (int c = (int)floorf(lead) + 1; c <= (int)floorf(to); c++) {
+                if (layer(w, b, a, c)) {
+                    to = c - SKIN;
+                    break;
+                }
+            }
+        } else {
+            for (int c = (int)floorf(lead) - 1; c >= (int)floorf(to); c--) {
+                if (layer(w, b, a, c)) {
+                    to = c + 1 + SKIN;
+                    break;
+                }
+            }
+        }
+        float moved = to - lead;
+        // never backwards, a box already closer than SKIN to a face stays where it is
+        if ((d > 0 && moved < 0) || (d < 0 && moved > 0)) moved = 0;
+        b.position[a] += moved;
+        return moved;
+    }
+
+    struct Result {
+        bool ground = false, ceiling = false;  // the vertical move was stopped from below or above
+        bool wall = false;                     // either horizontal one was
+        bool stepped = false;                  // went up a step to get there
+    };
+
+    // move by d, x and z first then y; a box standing on the ground that is stopped by a wall tries again
+    // `step` higher and takes that when it gets further, stepping down onto what is there
+    inline Result move(const world::World &w, Body &b, const float d[3], float step) {
+        Result r;
+        float start[3] = {b.position[0], b.position[1], b.position[2]};
+        float mx = sweep(w, b, 0, d[0]), mz = sweep(w, b, 2, d[2]);
+        r.wall = mx != d[0] || mz != d[2];
+
+        if (r.wall && step > 0) {
+            float flat[3] = {b.position[0], b.position[1], b.position[2]};
+            b.position[0] = start[0];
+            b.position[2] = start[2];
+            float up = sweep(w, b, 1, step);
+            float sx = sweep(w, b, 0, d[0]), sz = sweep(w, b, 2, d[2]);
+            if (sx * sx + sz * sz > mx * mx + mz * mz + SKIN) {
+                sweep(w, b, 1, -up);
+                r.stepped = true;
+                r.wall = sx != d[0] || sz != d[2];
+            } else {
+                for (int k = 0; k < 3; k++) b.position[k] = flat[k];
+            }
+        }
+
+        float my = sweep(w, b, 1, d[1]);
+        r.ground = d[1] < 0 && my != d[1];
+        r.ceiling = d[1] > 0 && my != d[1];
+        return r;
+    }
+
+    // out of whatever it was put into (an edit, a respawn): up to the first place the box fits
+    // NOTE: the top of the world is always free, so this ends
+    inline bool unstick(const world::World &w, Body &b) {
+        if (!inside(w, b)) return false;
+        while (inside(w, b)) b.position[1] = floorf(b.position[1]) + 1 + SKIN;
+        return true;
+    }
+}
@@ -0,0 +1,322 @@
+// Bulk block edits: fill and replace inside a box, copy and paste, and an undo journal of compact diffs
+// NOTE: no raylib in here; an edit goes chunk by chunk straight into the block arrays, and every chunk it
+// changed is recounted, relit and marked for a new mesh once, however many of its blocks changed
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "light.cpp"
+
+namespace edit
+{
+    // up to this many changed blocks are relit one by one, more and the chunks around are lit again from scratch
+    const size_t RELIGHT_BLOCKS = 64;
+
+    // blocks from (x0, y0, z0) to (x1, y1, z1), both included
+    struct Box {
+        int x0 = 0, y0 = 0, z0 = 0, x1 = -1, y1 = -1, z1 = -1;
+
+        // the box between two corners in any order, cut to the world's height
+        static Box between(int ax, int ay, int az, int bx, int by, int bz) {
+            Box b;
+            b.x0 = std::min(ax, bx);
+            b.x1 = std::max(ax, bx);
+            b.y0 = std::max(std::min(ay, by), 0);
+            b.y1 = std::min(std::max(ay, by), world::CHUNK_HEIGHT - 1);
+            b.z0 = std::min(az, bz);
+            b.z1 = std::max(az, bz);
+            return b;
+        }
+
+        bool empty() const { return x1 < x0 || y1 < y0 || z1 < z0; }
+        long long volume() const { return empty() ? 0 : (long long)(x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1); }
+    };
+
+    // consecutive blocks of a chunk, in index() order, that were all `was` and are now all `now`
+    struct Run {
+        unsigned short start, count;
+        unsigned char was, now;
+    };
+
+    struct ChunkDiff {
+        int cx, cz;
+        std::vector<Run> runs;
+    };
+
+    // the blocks one edit changed
+    struct Change {
+        std::vector<ChunkDiff> chunks;
+        size_t blocks = 0;
+
+        size_t bytes() const {
+            size_t n = sizeof(*this);
+            for (const ChunkDiff &d : chunks) n += sizeof(d) + d.runs.size() * sizeof(Run);
+            return n;
+        }
+    };
+
+    // a copied box of blocks, in the same order as a chunk's: x, then z, then y
+    struct Clip {
+        int sx = 0, sy = 0, sz = 0;
+        std::vector<unsigned char> blocks;
+
+        CubeType at(int x, int y, int z) const { return (CubeType)blocks[((size_t)y * sz + z) * sx + x]; }
+    };
+
+    inline void record(ChunkDiff &d, int i, unsigned char was, unsigned char now) {
+        if (!d.runs.empty()) {
+            Run &r = d.runs.back();
+            if (r.start + r.count == i && r.was == was && r.now == now) {
+                r.count++;
+                return;
+            }
+        }
+        d.runs.push_back(Run {(unsigned short)i, 1, was, now});
+    }
+
+    // set every block of `b` in a loaded chunk to fn(x, y, z, was) and record what changed
+    // NOTE: unloaded chunks are left out, the streamer would only generate them again as they were
+    template <typename F>
+    Change write(world::World &w, const Box &b, F fn) {
+        using namespace world;
+        Change out;
+        if (b.empty()) return out;
+        for (int cx = chunk_of(b.x0); cx <= chunk_of(b.x1); cx++) {
+            for (int cz = chunk_of(b.z0); cz <= chunk_of(b.z1); cz++) {
+                Chunk *c = w.chunk(cx, cz);
+                if (!c) continue;
+                int ox = cx * CHUNK_SIZE, oz = cz * CHUNK_SIZE;
+                int lx0 = std::max(b.x0 - ox, 0), lx1 = std::min(b.x1 - ox, CHUNK_SIZE - 1);
+                int lz0 = std::max(b.z0 - oz, 0), lz1 = std::min(b.z1 - oz, CHUNK_SIZE - 1);
+                ChunkDiff d {cx, cz, {}};
+                for (int y = b.y0; y <= b.y1; y++) {
+                    for (int lz = lz0; lz <= lz1; lz++) {
+                        unsigned char *row = c->blocks + index(0, y, lz);
+                        for (int lx = lx0; lx <= lx1; lx++) {
+                            unsigned char was = row[lx], now = fn(ox + lx, y, oz + lz, (CubeType)was);
+                            if (now == was) continue;
+                            row[lx] = now;
+                            record(d, index(lx, y, lz), was, now);
+                        }
+                    }
+                }
+                if (d.runs.empty()) continue;
+                for (const Run &r : d.runs) out.blocks += r.count;
+                out.chunks.push_back(std::move(d));
+            }
+        }
+        return out;
+    }
+
+    // the blocks are written already: recount the chunks, relight them, and put every chunk whose mesh
+    // changed in `dirty` with its revision bumped, so a mesh of it started before is thrown away
+    // NOTE: light goes at most 15 blocks, so past the changed chunks only the ring around them can change;
+    // the ring is seeded again too and joined to what is around it, and only chunks whose light differs are remeshed
+    void finish(world::World &w, const Change &change, std::unordered_set<long long> &dirty) {
+        using namespace world;
+        std::unordered_set<long long> touched;
+        auto mark = [&](int cx, int cz) {
+            if (w.chunk(cx, cz)) touched.insert(key(cx, cz));
+        };
+
+        for (const ChunkDiff &d : change.chunks) {
+            Chunk *c = w.chunk(d.cx, d.cz);
+            if (!c) continue;
+            c->recount();
+            c->unsaved = true;
+            // border blocks show or hide faces of the neighbours, corner blocks shade the diagonal ones
+            bool edge[3][3] = {};
+            for (const Run &r : d.runs) {
+                for (int i = r.start; i < r.start + r.count; i++) {
+                    int lx = i % CHUNK_SIZE, lz = i / CHUNK_SIZE % CHUNK_SIZE;
+                    int ex = lx == 0 ? 0 : lx == CHUNK_SIZE - 1 ? 2 : 1, ez = lz == 0 ? 0 : lz == CHUNK_SIZE - 1 ? 2 : 1;
+                    edge[ex][ez] = edge[ex][1] = edge[1][ez] = true;
+                }
+            }
+            for (int ex = 0; ex < 3; ex++)
+                for (int ez = 0; ez < 3; ez++)
+                    if (edge[ex][ez]) mark(d.cx + ex - 1, d.cz + ez - 1);
+            touched.insert(key(d.cx, d.cz));
+        }
+
+        if (change.blocks <= RELIGHT_BLOCKS) {
+            // light::update() takes one change at a time, so the blocks go back and are set again one by one
+            for (const ChunkDiff &d : change.chunks) {
+                Chunk *c = w.chunk(d.cx, d.cz);
+                for (const Run &r : d.runs) memset(c->blocks + r.start, r.was, r.count);
+            }
+            for (const ChunkDiff &d : change.chunks) {
+                Chunk *c = w.chunk(d.cx, d.cz);
+                for (const Run &r : d.runs) {
+                    for (int i = r.start; i < r.start + r.count; i++) {
+                        c->blocks[i] = r.now;
+                        int x = d.cx * CHUNK_SIZE + i % CHUNK_SIZE, z = d.cz * CHUNK_SIZE + i / CHUNK_SIZE % CHUNK_SIZE;
+                        light::update(w, x, i / CHUNK_AREA, z, (CubeType)r.was, touched);
+                    }
+                }
+            }
+        } else {
+            std::unordered_map<long long, std::vector<unsigned char>> before;
+            for (const ChunkDiff &d : change.chunks) {
+                for (int cx = d.cx - 1; cx <= d.cx + 1; cx++) {
+                    for (int cz = d.cz - 1; cz <= d.cz + 1; cz++) {
+                        Chunk *c = w.chunk(cx, cz);
+                        if (c && !before.count(key(cx, cz))) before[key(cx, cz)].assign(c->light, c->light + CHUNK_VOLUME);
+                    }
+                }
+            }
+            for (auto &it : before) light::seed(*w.chunks.at(it.first));
+            std::unordered_set<long long> joined;
+            for (auto &it : before) {
+                const Chunk *c = w.chunks.at(it.first).get();
+                light::join(w, c->cx, c->cz, joined);
+            }
+
+            // faces take the light of the air in front of them, so a changed border cell shows in the neighbour too
+            for (auto &it : before) {
+                const Chunk *c = w.chunks.at(it.first).get();
+                const unsigned char *old = it.second.data();
+                bool any = false, edge[4] = {};
+                for (int i = 0; i < CHUNK_VOLUME; i++) {
+                    if (old[i] == c->light[i]) continue;
+                    int lx = i % CHUNK_SIZE, lz = i / CHUNK_SIZE % CHUNK_SIZE;
+                    any = true;
+                    edge[0] |= lx == 0;
+                    edge[1] |= lx == CHUNK_SIZE - 1;
+                    edge[2] |= lz == 0;
+                    edge[3] |= lz == CHUNK_SIZE - 1;
+                }
+                if (!any) continue;
+                touched.insert(it.first);
+                if (edge[0]) mark(c->cx - 1, c->cz);
+                if (edge[1]) mark(c->cx + 1, c->cz);
+                if (edge[2]) mark(c->cx, c->cz - 1);
+                if (edge[3]) mark(c->cx, c->cz + 1);
+            }
+            for (long long k : joined) touched.insert(k);
+        }
+
+        for (long long k : touched) {
+            auto it = w.chunks.find(k);
+            if (it == w.chunks.end()) continue;
+            it->second->revision++;
+            dirty.insert(k);
+        }
+    }
+
+    // edits that can be undone and redone, the latest last
+    // NOTE: only the changed blocks are kept, as runs per chunk; past `limit` bytes the oldest edits are forgotten
+    struct Journal {
+        std::vector<Change> done, undone;
+        size_t limit = 64 << 20;
+
+        size_t bytes() const {
+            size_t n = 0;
+            for (const Change &c : done) n += c.bytes();
+            for (const Change &c : undone) n += c.bytes();
+            return n;
+        }
+
+        void record(Change c) {
+            if (c.chunks.empty()) return;
+            undone.clear();
+            done.push_back(std::move(c));
+            size_t n = bytes(), drop = 0;
+            while (n > limit && drop + 1 < done.size()) n -= done[drop++].bytes();
+            done.erase(done.begin(), done.begin() + drop);
+        }
+
+        // put back what the last edit changed, false when there is nothing to undo
+        // NOTE: chunks unloaded since are left as they are, and a block changed by something else since is too
+        bool undo(world::World &w, std::unordered_set<long long> &dirty) {
+            if (done.empty()) return false;
+            restore(w, done.back(), false, dirty);
+            undone.push_back(std::move(done.back()));
+            done.pop_back();
+            return true;
+        }
+
+        bool redo(world::World &w, std::unordered_set<long long> &dirty) {
+            if (undone.empty()) return false;
+            restore(w, undone.back(), true, dirty);
+            done.push_back(std::move(undone.back()));
+            undone.pop_back();
+            return true;
+        }
+
+        static void restore(world::World &w, const Change &c, bool forward, std::unordered_set<long long> &dirty) {
+            Change applied;
+            for (const ChunkDiff &d : c.chunks) {
+                world::Chunk *chunk = w.chunk(d.cx, d.cz);
+                if (!chunk) continue;
+                ChunkDiff out {d.cx, d.cz, {}};
+                for (const Run &r : d.runs) {
+                    unsigned char from = forward ? r.was : r.now, to = forward ? r.now : r.was;
+                    for (int i = r.start; i < r.start + r.count; i++) {
+                        if (chunk->blocks[i] != from) continue;
+                        chunk->blocks[i] = to;
+                        edit::record(out, i, from, to);
+                        applied.blocks++;
+                    }
+                }
+                if (!out.runs.empty()) applied.chunks.push_back(std::move(out));
+            }
+            finish(w, applied, dirty);
+        }
+    };
+
+    // every block of `b` becomes `t`, returns how many changed
+    size_t fill(world::World &w, const Box &b, CubeType t, std::unordered_set<long long> &dirty, Journal *journal = nullptr) {
+        Change c = write(w, b, [t](int, int, int, CubeType) { return t; });
+        finish(w, c, dirty);
+        size_t n = c.blocks;
+        if (journal) journal->record(std::move(c));
+        return n;
+    }
+
+    // every `from` block of `b` becomes `to`, returns how many changed
+    size_t replace(world::World &w, const Box &b, CubeType from, CubeType to, std::unordered_set<long long> &dirty, Journal *journal = nullptr) {
+        Change c = write(w, b, [from, to](int, int, int, CubeType was) { return was == from ? to : was; });
+        finish(w, c, dirty);
+        size_t n = c.blocks;
+        if (journal) journal->record(std::move(c));
+        return n;
+    }
+
+    // the blocks of `b`, air where no chunk is loaded
+    Clip copy(const world::World &w, const Box &b) {
+        using namespace world;
+        Clip clip;
+        if (b.empty()) return clip;
+        clip.sx = b.x1 - b.x0 + 1;
+        clip.sy = b.y1 - b.y0 + 1;
+        clip.sz = b.z1 - b.z0 + 1;
+        clip.blocks.assign((size_t)clip.sx * clip.sy * clip.sz, Air);
+        for (int cx = chunk_of(b.x0); cx <= chunk_of(b.x1); cx++) {
+            for (int cz = chunk_of(b.z0); cz <= chunk_of(b.z1); cz++) {
+                const Chunk *c = w.chunk(cx, cz);
+                if (!c) continue;
+                int x0 = std::max(b.x0, cx * CHUNK_SIZE), x1 = std::min(b.x1, cx * CHUNK_SIZE + CHUNK_SIZE - 1);
+                int z0 = std::max(b.z0, cz * CHUNK_SIZE), z1 = std::min(b.z1, cz * CHUNK_SIZE + CHUNK_SIZE - 1);
+                for (int y = b.y0; y <= b.y1; y++)
+                    for (int z = z0; z <= z1; z++)
+                        memcpy(&clip.blocks[((size_t)(y - b.y0) * clip.sz + z - b.z0) * clip.sx + x0 - b.x0],
+                               c->blocks + index(local_of(x0), y, local_of(z)), x1 - x0 + 1);
+            }
+        }
+        return clip;
+    }
+
+    // the clip with its lowest corner at (x, y, z), air included; whatever is past the world's height is cut
+    size_t paste(world::World &w, const Clip &clip, int x, int y, int z, std::unordered_set<long long> &dirty, Journal *journal = nullptr) {
+        if (clip.blocks.empty()) return 0;
+        Box b = Box::between(x, y, z, x + clip.sx - 1, y + clip.sy - 1, z + clip.sz - 1);
+        Change c = write(w, b, [&clip, x, y, z](int bx, int by, int bz, CubeType) { return clip.at(bx - x, by - y, bz - z); });
+        finish(w, c, dirty);
+        size_t n = c.blocks;
+        if (journal) journal->record(std::move(c));
+        return n;
+    }
+}
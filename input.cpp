@@ -0,0 +1,102 @@
+// Per-frame player input, and the binary log it is recorded to and replayed from
+// NOTE: no raylib in here, the game fills Input from raylib and a replay from the log
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace input
+{
+    // buttons, as bits of Input::down (held this frame) and Input::pressed (went down this frame)
+    enum Button : unsigned short {
+        Forward = 1 << 0,
+        Back = 1 << 1,
+        Right = 1 << 2,
+        Left = 1 << 3,
+        Jump = 1 << 4,
+        Slow = 1 << 5,  // left shift
+        Respawn = 1 << 6,
+        FreeObserve = 1 << 7,
+        Break = 1 << 8,  // left mouse button
+        Place = 1 << 9,  // right mouse button
+        PlaceLamp = 1 << 10,  // middle mouse button
+        Mark = 1 << 11,   // a corner of the selection
+        Fill = 1 << 12,   // the selection with dirt, with Slow held with air
+        Copy = 1 << 13,   // the selection
+        Paste = 1 << 14,  // against the face under the crosshair
+        Undo = 1 << 15    // the last bulk edit, with Slow held redo it
+    };
+
+    struct Input {
+        float dt = 0;             // seconds the step covers, FIXED_DT in a log
+        float mouse[2] = {0, 0};  // mouse movement in pixels
+        unsigned short down = 0, pressed = 0;
+    };
+
+    const unsigned MAGIC = 0x4e494352;  // "RCIN"
+    // 2: one entry per tick and the PlaceLamp to Undo buttons; 1 held one per drawn frame at its own dt and is refused
+    const unsigned VERSION = 2;
+    const float FIXED_DT = 1 / 60.0f;  // the tick thread and replays step the simulation at this rate, whatever dt was recorded
+
+    // the header, then FRAME_BYTES per tick: dt, mouse x, mouse y (floats) and down, pressed (shorts)
+    // NOTE: written in host byte order, logs are meant for comparing builds on the same machine
+    struct Header {
+        unsigned magic = MAGIC, version = VERSION;
+        int seed = 0;
+    };
+    const size_t FRAME_BYTES = 3 * sizeof(float) + 2 * sizeof(unsigned short);
+
+    struct Recorder {
+        FILE *file = nullptr;
+        size_t frames = 0;
+
+        bool open(const char *path, int seed) {
+            Header h;
+            h.seed = seed;
+            file = fopen(path, "wb");
+            return file && fwrite(&h, sizeof(h), 1, file) == 1;
+        }
+
+        void write(const Input &in) {
+            if (!file) return;
+            unsigned char b[FRAME_BYTES];
+            memcpy(b, &in.dt, 4);
+            memcpy(b + 4, in.mouse, 8);
+            memcpy(b + 12, &in.down, 2);
+            memcpy(b + 14, &in.pressed, 2);
+            fwrite(b, FRAME_BYTES, 1, file);
+            frames++;
+        }
+
+        void close() {
+            if (file) fclose(file);
+            file = nullptr;
+        }
+
+        ~Recorder() { close(); }
+    };
+
+    // a whole recorded session, read up front
+    struct Log {
+        Header header;
+        std::vector<Input> frames;
+
+        // false for a missing file, or one of another format or version
+        bool load(const char *path) {
+            FILE *f = fopen(path, "rb");
+            if (!f) return false;
+            bool ok = fread(&header, sizeof(header), 1, f) == 1 && header.magic == MAGIC && header.version == VERSION;
+            unsigned char b[FRAME_BYTES];
+            while (ok && fread(b, FRAME_BYTES, 1, f) == 1) {
+                Input in;
+                memcpy(&in.dt, b, 4);
+                memcpy(in.mouse, b + 4, 8);
+                memcpy(&in.down, b + 12, 2);
+                memcpy(&in.pressed, b + 14, 2);
+                frames.push_back(in);
+            }
+            fclose(f);
+            return ok;
+        }
+    };
+}
@@ -0,0 +1,321 @@
+// Work-stealing job pool shared by chunk streaming, saving, map generation and the CPU renderer
+// NOTE: every worker owns a deque per priority and takes from the front of its own, an idle worker steals
+// from the back of the others'; a job's `done` goes back to whichever thread calls complete()
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "profile.cpp"
+
+namespace jobs
+{
+    // lower runs first, whatever was queued before it
+    enum Priority { Near = 0, Normal, Far, Background };
+    const int PRIORITIES = 4;
+    const int CHANNELS = 16;  // kinds of jobs with their own counters
+
+    inline long long now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // counters of one kind of job, relaxed atomics so nobody waits on them
+    struct Channel {
+        const char *name = nullptr;
+        std::atomic<int> depth{0}, running{0};  // queued, and taken by a thread
+        std::atomic<long long> submitted{0}, finished{0}, stolen{0};
+        std::atomic<long long> wait_ns{0}, wait_max_ns{0}, run_ns{0};  // queued to started, started to finished
+    };
+
+    // a copy of a channel's counters, times in ms
+    struct Stats {
+        const char *name;
+        int depth, running;
+        long long submitted, finished, stolen;
+        double wait_avg, wait_max, run_avg;
+    };
+
+    struct Job {
+        int channel;
+        std::function<void()> work, done;
+        long long queued;  // now_ns() when submitted
+    };
+
+    struct Pool {
+        struct Queue {
+            std::mutex lock;
+            std::deque<Job> items[PRIORITIES];
+        };
+
+        std::vector<std::thread> threads;
+        std::vector<std::unique_ptr<Queue>> queues;  // one per worker, the callers' of run() last
+        Channel channels[CHANNELS];
+        int channel_count = 0;
+        std::atomic<unsigned> next{0};  // queue the next job from outside the pool goes to
+
+        std::mutex lock;
+        std::condition_variable wake, idle;
+        int queued = 0, running = 0;  // over all channels, under `lock`
+        bool quit = false;
+
+        std::mutex finished_lock;
+        std::deque<std::function<void()>> finished;  // `done` of finished jobs, for complete()
+
+        // the pool and queue of the worker this thread is
+        struct Worker {
+            const Pool *pool = nullptr;
+            int queue = -1;
+        };
+        static Worker &worker() {
+            static thread_local Worker w;
+            return w;
+        }
+        int self() const { return worker().pool == this ? worker().queue : -1; }
+
+        // NOTE: with no workers submit() runs a job on the spot and run() on the caller, a pool to compare against
+        Pool(int workers = -1) {
+            if (workers < 0) workers = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+            for (int i = 0; i <= workers; i++) queues.emplace_back(new Queue());
+            for (int i = 0; i < workers; i++) threads.emplace_back([this, i]() { work(i); });
+        }
+
+        ~Pool() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                quit = true;
+            }
+            wake.notify_all();
+            for (auto &t : threads) t.join();
+        }
+
+        int workers() const { return threads.size(); }
+
+        // id of the channel called `name`, made on first use; main thread, before anything is submitted on it
+        int channel(const char *name) {
+            for (int i = 0; i < channel_count; i++)
+                if (!strcmp(channels[i].name, name)) return i;
+            if (channel_count == CHANNELS) return CHANNELS - 1;
+            channels[channel_count].name = name;
+            return channel_count++;
+        }
+
+        // queue `work` on a worker; `done`, when given, runs on the thread that calls complete() once it finished
+        // NOTE: a job submitted from inside a job goes to the same worker's queue, others round robin
+        void submit(int ch, int priority, std::function<void()> work, std::function<void()> done = nullptr) {
+            Job job { ch, std::move(work), std::move(done), now_ns() };
+            if (threads.empty()) {
+                channels[ch].submitted++;
+                channels[ch].depth++;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    queued++;
+                }
+                execute(job, false);
+                return;
+            }
+            int q = self() >= 0 ? self() : (int)(next++ % threads.size());
+            push(q, priority, std::move(job));
+        }
+
+        // NOTE: counted before it is on a queue, a worker that takes it right away never sees `queued` below zero
+        void push(int q, int priority, Job job) {
+            Channel &c = channels[job.channel];
+            c.submitted++;
+            c.depth++;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                queued++;
+            }
+            {
+                std::lock_guard<std::mutex> guard(queues[q]->lock);
+                queues[q]->items[priority].push_back(std::move(job));
+            }
+            wake.notify_one();
+        }
+
+        // fn(0) .. fn(count - 1) across the workers and the calling thread, returns when all are done
+        // NOTE: each thread gets one contiguous run of the items, those that finish early steal the ends of the others'.
+        // The batch is on the caller's stack: the last job counts down and notifies under its lock, so the caller
+        // can't see zero and return while a worker still holds it
+        void run(int ch, int count, const std::function<void(int)> &fn) {
+            struct Batch {
+                int left;  // under `lock`
+                std::mutex lock;
+                std::condition_variable done;
+            } batch;
+            batch.left = count;
+            int n = queues.size(), caller = n - 1;
+            for (int q = 0; q < n; q++) {
+                for (int i = (long long)count * q / n; i < (long long)count * (q + 1) / n; i++) {
+                    push(q, Near, Job { ch, [&fn, &batch, i]() {
+                        fn(i);
+                        std::lock_guard<std::mutex> guard(batch.lock);
+                        if (--batch.left == 0) batch.done.notify_all();
+                    }, nullptr, now_ns() });
+                }
+            }
+            // the caller works through its own run, then helps with whatever else is urgent until the batch is done
+            Job job;
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> guard(batch.lock);
+                    if (batch.left == 0) break;
+                }
+                bool stolen = false, found = pop(caller, Near, false, job);
+                for (int k = 0; k < caller && !found; k++) found = stolen = pop(k, Near, true, job);
+                if (!found) break;
+                execute(job, stolen);
+            }
+            std::unique_lock<std::mutex> guard(batch.lock);
+            batch.done.wait(guard, [&batch]() { return batch.left == 0; });
+        }
+
+        bool pop(int q, int priority, bool steal, Job &job) {
+            std::lock_guard<std::mutex> guard(queues[q]->lock);
+            std::deque<Job> &items = queues[q]->items[priority];
+            if (items.empty()) return false;
+            if (steal) {
+                job = std::move(items.back());
+                items.pop_back();
+            } else {
+                job = std::move(items.front());
+                items.pop_front();
+            }
+            return true;
+        }
+
+        // the most urgent job there is: own queue first, then the others', a priority at a time
+        bool find(int q, Job &job, bool &stolen) {
+            int n = queues.size();
+            for (int p = 0; p < PRIORITIES; p++) {
+                if (pop(q, p, false, job)) {
+                    stolen = false;
+                    return true;
+                }
+                for (int k = 1; k < n; k++) {
+                    if (pop((q + k) % n, p, true, job)) {
+                        stolen = true;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        void execute(Job &job, bool stolen) {
+            Channel &c = channels[job.channel];
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                queued--;
+                running++;
+            }
+            c.depth--;
+            c.running++;
+            if (stolen) c.stolen++;
+            long long start = now_ns(), wait = start - job.queued;
+            c.wait_ns += wait;
+            for (long long m = c.wait_max_ns; wait > m && !c.wait_max_ns.compare_exchange_weak(m, wait);) {}
+
+            job.work();
+
+            c.run_ns += now_ns() - start;
+            c.running--;
+            c.finished++;
+            if (job.done) {
+                std::lock_guard<std::mutex> guard(finished_lock);
+                finished.push_back(std::move(job.done));
+            }
+            job.work = nullptr;
+            bool empty;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                running--;
+                empty = queued == 0 && running == 0;
+            }
+            if (empty) idle.notify_all();
+        }
+
+        void work(int q) {
+            worker().pool = this;
+            worker().queue = q;
+            profile::name_thread("jobs");
+            for (;;) {
+                Job job;
+                bool stolen;
+                if (find(q, job, stolen)) {
+                    execute(job, stolen);
+                    continue;
+                }
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [this]() { return quit || queued > 0; });
+                if (quit) return;
+            }
+        }
+
+        // block until no job is queued or running; their `done` may still wait for complete()
+        void wait() {
+            std::unique_lock<std::mutex> guard(lock);
+            idle.wait(guard, [this]() { return queued == 0 && running == 0; });
+        }
+
+        // throw away the queued jobs of a channel, the running ones finish; returns how many were dropped
+        int cancel(int ch) {
+            int dropped = 0;
+            for (auto &q : queues) {
+                std::lock_guard<std::mutex> guard(q->lock);
+                for (auto &items : q->items) {
+                    for (auto it = items.begin(); it != items.end();) {
+                        if (it->channel != ch) {
+                            it++;
+                            continue;
+                        }
+                        it = items.erase(it);
+                        dropped++;
+                    }
+                }
+            }
+            channels[ch].depth -= dropped;
+            bool empty;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                queued -= dropped;
+                empty = queued == 0 && running == 0;
+            }
+            if (empty) idle.notify_all();
+            return dropped;
+        }
+
+        // run the `done` of finished jobs in the order they finished, until `budget` seconds are spent
+        size_t complete(double budget) {
+            long long t0 = now_ns();
+            size_t n = 0;
+            for (;;) {
+                std::function<void()> done;
+                {
+                    std::lock_guard<std::mutex> guard(finished_lock);
+                    if (finished.empty()) break;
+                    done = std::move(finished.front());
+                    finished.pop_front();
+                }
+                done();
+                n++;
+                if ((now_ns() - t0) * 1e-9 > budget) break;
+            }
+            return n;
+        }
+
+        Stats stats(int ch) const {
+            const Channel &c = channels[ch];
+            long long f = c.finished, started = f + c.running;
+            return Stats { c.name, c.depth, c.running, c.submitted, f, c.stolen,
+                           started ? c.wait_ns * 1e-6 / started : 0, c.wait_max_ns * 1e-6, f ? c.run_ns * 1e-6 / f : 0 };
+        }
+    };
+}
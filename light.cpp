@@ -0,0 +1,267 @@
+// Voxel light, sky light and block light flood filled through the air with breadth-first queues
+// NOTE: no raylib in here; a chunk is seeded on its own (on a worker), joined to its neighbours when it is put
+// in the world, and every edit after that only relights the cells whose light depended on the changed block
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+#include "world.cpp"
+
+namespace light
+{
+    const int MAX = 15;
+    const int SKY = 4, BLOCK = 0;  // shift of each channel in a light byte, sky << 4 | block
+
+    // light given off, by CubeType
+    const unsigned char EMIT[5] = {0, 0, 0, 0, MAX};
+    inline int emission(CubeType t) { return EMIT[t]; }
+
+    inline int get(unsigned char l, int ch) { return l >> ch & 0xf; }
+    inline void put(unsigned char &l, int ch, int v) { l = (l & ~(0xf << ch)) | v << ch; }
+
+    // light of the air above the world, and below it
+    const unsigned char OPEN = MAX << SKY, BURIED = 0;
+
+    // neighbour offsets, down is 3
+    const int STEP[6][3] = {{0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}};
+    const int DOWN = 3;
+
+    struct Node {
+        int x, y, z;
+        unsigned char level;  // removal only, the light the cell had
+    };
+
+    // one chunk in local coordinates, nothing past its border
+    struct ChunkSpace {
+        world::Chunk &c;
+
+        bool cell(int x, int y, int z, unsigned char *&l, CubeType &t) {
+            using namespace world;
+            if (x < 0 || x >= CHUNK_SIZE || z < 0 || z >= CHUNK_SIZE || y < 0 || y >= CHUNK_HEIGHT) return false;
+            int i = index(x, y, z);
+            l = &c.light[i];
+            t = (CubeType)c.blocks[i];
+            return true;
+        }
+        void changed(int, int, int) {}
+    };
+
+    // the loaded world in block coordinates, every chunk whose mesh a change shows in goes to `touched`
+    // NOTE: a cell on a chunk border is the air in front of faces of the neighbour too
+    struct WorldSpace {
+        world::World &w;
+        std::unordered_set<long long> &touched;
+        world::Chunk *last = nullptr;
+        int lcx = 0, lcz = 0;
+        bool cached = false;
+
+        world::Chunk *chunk(int x, int z) {
+            int cx = world::chunk_of(x), cz = world::chunk_of(z);
+            if (!cached || cx != lcx || cz != lcz) {
+                last = w.chunk(cx, cz);
+                lcx = cx;
+                lcz = cz;
+                cached = true;
+            }
+            return last;
+        }
+
+        bool cell(int x, int y, int z, unsigned char *&l, CubeType &t) {
+            using namespace world;
+            if (y < 0 || y >= CHUNK_HEIGHT) return false;
+            Chunk *c = chunk(x, z);
+            if (!c) return false;
+            int i = index(local_of(x), y, local_of(z));
+            l = &c->light[i];
+            t = (CubeType)c->blocks[i];
+            return true;
+        }
+
+        void changed(int x, int, int z) {
+            using namespace world;
+            int cx = chunk_of(x), cz = chunk_of(z), lx = local_of(x), lz = local_of(z);
+            touched.insert(key(cx, cz));
+            if (lx == 0) touched.insert(key(cx - 1, cz));
+            if (lx == CHUNK_SIZE - 1) touched.insert(key(cx + 1, cz));
+            if (lz == 0) touched.insert(key(cx, cz - 1));
+            if (lz == CHUNK_SIZE - 1) touched.insert(key(cx, cz + 1));
+        }
+    };
+
+    // light from every queued cell into the air around it, one level less per step
+    // NOTE: full sky light goes straight down without fading, like sunlight
+    template <typename Space>
+    size_t spread(Space &s, std::vector<Node> &queue, int ch) {
+        size_t lit = 0;
+        for (size_t q = 0; q < queue.size(); q++) {
+            Node n = queue[q];
+            unsigned char *l;
+            CubeType t;
+            if (!s.cell(n.x, n.y, n.z, l, t)) continue;
+            int v = get(*l, ch);
+            if (v <= 1) continue;
+            for (int d = 0; d < 6; d++) {
+                int x = n.x + STEP[d][0], y = n.y + STEP[d][1], z = n.z + STEP[d][2];
+                unsigned char *nl;
+                CubeType nt;
+                if (!s.cell(x, y, z, nl, nt) || nt != Air) continue;
+                int to = (ch == SKY && d == DOWN && v == MAX) ? MAX : v - 1;
+                if (get(*nl, ch) >= to) continue;
+                put(*nl, ch, to);
+                s.changed(x, y, z);
+                queue.push_back(Node {x, y, z, 0});
+                lit++;
+            }
+        }
+        queue.clear();
+        return lit;
+    }
+
+    // take away the light that came from the queued cells (each with the level it had), cells lit from
+    // elsewhere go to `refill` to spread back in afterwards
+    template <typename Space>
+    size_t unspread(Space &s, std::vector<Node> &queue, std::vector<Node> &refill, int ch) {
+        size_t dark = 0;
+        for (size_t q = 0; q < queue.size(); q++) {
+            Node n = queue[q];
+            for (int d = 0; d < 6; d++) {
+                int x = n.x + STEP[d][0], y = n.y + STEP[d][1], z = n.z + STEP[d][2];
+                unsigned char *nl;
+                CubeType nt;
+                if (!s.cell(x, y, z, nl, nt)) continue;
+                int v = get(*nl, ch);
+                if (v == 0) continue;
+                bool from = v < n.level || (ch == SKY && d == DOWN && n.level == MAX && v == MAX);
+                if (from && !(ch == BLOCK && emission(nt))) {
+                    put(*nl, ch, 0);
+                    s.changed(x, y, z);
+                    queue.push_back(Node {x, y, z, (unsigned char)v});
+                    dark++;
+                } else {
+                    refill.push_back(Node {x, y, z, 0});
+                }
+            }
+        }
+        queue.clear();
+        return dark;
+    }
+
+    // a chunk on its own: sky light down every column to the first block, the emitters, and both spread inside it
+    void seed(world::Chunk &c) {
+        using namespace world;
+        static thread_local std::vector<Node> queue;
+        memset(c.light, 0, sizeof(c.light));
+
+        int top = -1;
+        for (short h : c.height) top = std::max<int>(top, h);
+        for (int lz = 0; lz < CHUNK_SIZE; lz++)
+            for (int lx = 0; lx < CHUNK_SIZE; lx++)
+                for (int y = c.top(lx, lz) + 1; y < CHUNK_HEIGHT; y++) put(c.light[index(lx, y, lz)], SKY, MAX);
+
+        // above the tallest column every neighbour is sky already, below it light can go sideways under overhangs
+        ChunkSpace s {c};
+        for (int lz = 0; lz < CHUNK_SIZE; lz++)
+            for (int lx = 0; lx < CHUNK_SIZE; lx++)
+                for (int y = c.top(lx, lz) + 1; y <= top; y++) queue.push_back(Node {lx, y, lz, 0});
+        spread(s, queue, SKY);
+
+        for (int i = 0; i < CHUNK_VOLUME; i++) {
+            int e = emission((CubeType)c.blocks[i]);
+            if (!e) continue;
+            put(c.light[i], BLOCK, e);
+            queue.push_back(Node {i % CHUNK_SIZE, i / CHUNK_AREA, i / CHUNK_SIZE % CHUNK_SIZE, 0});
+        }
+        spread(s, queue, BLOCK);
+    }
+
+    // light across the borders of chunk (cx, cz), just put in the world after seed(), and its loaded neighbours
+    size_t join(world::World &w, int cx, int cz, std::unordered_set<long long> &touched) {
+        using namespace world;
+        static thread_local std::vector<Node> queue;
+        WorldSpace s {w, touched};
+        const Chunk *c = w.chunk(cx, cz);
+        if (!c) return 0;
+
+        size_t lit = 0;
+        const int around[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+        for (int ch : {SKY, BLOCK}) {
+            for (const auto &a : around) {
+                const Chunk *n = w.chunk(cx + a[0], cz + a[1]);
+                if (!n) continue;
+                // the cell on each side of the border, the brighter one spreads into the other
+                for (int i = 0; i < CHUNK_SIZE; i++) {
+                    int lx = a[0] < 0 ? 0 : a[0] > 0 ? CHUNK_SIZE - 1 : i, lz = a[1] < 0 ? 0 : a[1] > 0 ? CHUNK_SIZE - 1 : i;
+                    int nx = a[0] ? CHUNK_SIZE - 1 - lx : lx, nz = a[1] ? CHUNK_SIZE - 1 - lz : lz;
+                    for (int y = 0; y < CHUNK_HEIGHT; y++) {
+                        int v = get(c->light[index(lx, y, lz)], ch), nv = get(n->light[index(nx, y, nz)], ch);
+                        if (v > nv + 1) queue.push_back(Node {cx * CHUNK_SIZE + lx, y, cz * CHUNK_SIZE + lz, 0});
+                        else if (nv > v + 1) queue.push_back(Node {n->cx * CHUNK_SIZE + nx, y, n->cz * CHUNK_SIZE + nz, 0});
+                    }
+                }
+            }
+            lit += spread(s, queue, ch);
+        }
+        return lit;
+    }
+
+    // block (x, y, z) was `was` and has just been set to what it is now; returns the cells whose light changed
+    size_t update(world::World &w, int x, int y, int z, CubeType was, std::unordered_set<long long> &touched) {
+        using namespace world;
+        static thread_local std::vector<Node> removed, refill;
+        WorldSpace s {w, touched};
+        unsigned char *l;
+        CubeType now;
+        if (!s.cell(x, y, z, l, now)) return 0;
+
+        size_t n = 0;
+        for (int ch : {SKY, BLOCK}) {
+            int old = get(*l, ch);
+            if (now != Air || (ch == BLOCK && emission(was))) {
+                // a block in the way, or an emitter taken out: the light through or from here goes
+                put(*l, ch, 0);
+                s.changed(x, y, z);
+                removed.push_back(Node {x, y, z, (unsigned char)old});
+                n += unspread(s, removed, refill, ch);
+            }
+            if (ch == BLOCK && emission(now)) {
+                put(*l, ch, emission(now));
+                refill.push_back(Node {x, y, z, 0});
+            }
+            if (now == Air) {
+                // an opening, the light around comes in
+                for (const auto &d : STEP) refill.push_back(Node {x + d[0], y + d[1], z + d[2], 0});
+                if (ch == SKY && y == CHUNK_HEIGHT - 1) {
+                    put(*l, ch, MAX);
+                    refill.push_back(Node {x, y, z, 0});
+                }
+            }
+            n += spread(s, refill, ch);
+        }
+        return n;
+    }
+
+    // light of the air at (x, y, z), sky above the world
+    inline unsigned char at(const world::World &w, int x, int y, int z) {
+        using namespace world;
+        if (y >= CHUNK_HEIGHT) return OPEN;
+        if (y < 0) return BURIED;
+        const Chunk *c = w.chunk(chunk_of(x), chunk_of(z));
+        return c ? c->light[index(local_of(x), y, local_of(z))] : OPEN;
+    }
+
+    // vertex colour of a light byte: the brighter of white sky light and warm block light
+    // NOTE: every level is 80% of the one above, with a little ambient so caves are never black
+    inline void colour(unsigned char l, unsigned char rgb[3]) {
+        static const auto curve = []() {
+            std::array<float, MAX + 1> c;
+            for (int i = 0; i <= MAX; i++) c[i] = 0.1f + 0.9f * powf(0.8f, (float)(MAX - i));
+            return c;
+        }();
+        const float warm[3] = {1.0f, 0.9f, 0.7f};
+        float sky = curve[get(l, SKY)], block = curve[get(l, BLOCK)];
+        for (int k = 0; k < 3; k++) rgb[k] = (unsigned char)(255 * std::max(sky, block * warm[k]) + 0.5f);
+    }
+}
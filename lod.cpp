@@ -0,0 +1,140 @@
+// Far terrain as coarse surface tiles, built from the terrain settings alone so no chunk has to be loaded
+// NOTE: no raylib in here; a level L tile covers 2^L x 2^L chunks with one cell per 2^L x 2^L columns
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "mesher.cpp"
+
+namespace lod
+{
+    const int LEVELS = 3;                 // 2x, 4x and 8x merges
+    const int CELLS = world::CHUNK_SIZE;  // cells along a tile side, at every level
+
+    // blocks along a tile side
+    inline int span(int level) { return world::CHUNK_SIZE << level; }
+    inline int tile_of(int v, int level) { return (v >= 0 ? v : v - (span(level) - 1)) / span(level); }
+    inline long long key(int level, int tx, int tz) { return world::key(tx, tz) * 4 + level; }
+
+    // distance in blocks from (x, z) to the nearest column of a tile
+    inline float distance(int level, int tx, int tz, float x, float z) {
+        float x0 = (float)tx * span(level), z0 = (float)tz * span(level);
+        float dx = std::max(std::max(x0 - x, x - (x0 + span(level))), 0.0f);
+        float dz = std::max(std::max(z0 - z, z - (z0 + span(level))), 0.0f);
+        return sqrtf(dx * dx + dz * dz);
+    }
+
+    // surface mesh of a tile: every cell is a column as tall as the tallest column it covers, with walls
+    // down to its lower neighbours. Walls on the tile border go down to the lowest column next to it,
+    // so finer tiles and chunks next to it never leave a crack
+    void build(const world::Terrain &t, int level, int tx, int tz, mesher::ChunkMesh &out) {
+        const int s = 1 << level, n = CELLS + 2;  // cells plus a border ring from the neighbours
+        const int x0 = tx * span(level), z0 = tz * span(level);
+        out.cx = tx;
+        out.cz = tz;
+        out.lod = level;
+        out.quads.clear();
+        out.graph.open();
+
+        // top solid y of every column, as generate() places the grass block; caves that open at the surface are left out
+        std::vector<short> high(n * n, 0), low(n * n, world::CHUNK_HEIGHT);
+        std::vector<float> row(n * s);
+        for (int z = 0; z < n * s; z++) {
+            t.noise.fbm2d_row(x0 - s, z0 - s + z, n * s, row.data());
+            for (int x = 0; x < n * s; x++) {
+                int h = (int)(row[x] * t.amplitude);
+                h = std::max(std::min(h, world::CHUNK_HEIGHT - 2), 1);
+                int c = (z / s) * n + x / s;
+                high[c] = std::max<short>(high[c], h);
+                low[c] = std::min<short>(low[c], h);
+            }
+        }
+
+        int min_y = world::CHUNK_HEIGHT, max_y = 0;
+        auto quad = [&](int x, int y, int z, int sx, int sy, int sz, int face, CubeType type) {
+            out.quads.push_back(mesher::Quad { x, y, z, {(unsigned char)sx, (unsigned char)sy, (unsigned char)sz},
+                                               (unsigned char)face, (unsigned char)mesher::tile(type, face) });
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y + sy);
+        };
+
+        // tops, runs of equal height along x merged
+        for (int j = 1; j <= CELLS; j++) {
+            for (int i = 1; i <= CELLS;) {
+                int h = high[j * n + i], run = 1;
+                while (i + run <= CELLS && high[j * n + i + run] == h) run++;
+                quad(x0 + (i - 1) * s, h, z0 + (j - 1) * s, run * s, 1, s, mesher::Top, Grass);
+                i += run;
+            }
+        }
+
+        // walls facing each lower neighbour, grass side on the top block and dirt below; runs of equal walls
+        // along the face merged (along x for front and back, along z for right and left)
+        const int around[4][3] = {{mesher::Right, 1, 0}, {mesher::Left, -1, 0}, {mesher::Front, 0, 1}, {mesher::Back, 0, -1}};
+        for (const auto &a : around) {
+            bool along_x = a[2] != 0;
+            auto wall = [&](int line, int pos, int &h) {
+                int i = along_x ? pos : line, j = along_x ? line : pos;
+                int ni = i + a[1], nj = j + a[2];
+                bool border = ni == 0 || nj == 0 || ni == n - 1 || nj == n - 1;
+                h = high[j * n + i];
+                return border ? low[nj * n + ni] : high[nj * n + ni];
+            };
+            for (int line = 1; line <= CELLS; line++) {
+                for (int pos = 1; pos <= CELLS;) {
+                    int h, below = wall(line, pos, h), run = 1, h2;
+                    if (below >= h) {
+                        pos++;
+                        continue;
+                    }
+                    while (pos + run <= CELLS && wall(line, pos + run, h2) == below && h2 == h) run++;
+                    int x = x0 + ((along_x ? pos : line) - 1) * s, z = z0 + ((along_x ? line : pos) - 1) * s;
+                    int sx = along_x ? run * s : s, sz = along_x ? s : run * s;
+                    quad(x, h, z, sx, 1, sz, a[0], Grass);
+                    if (h - below > 1) quad(x, below + 1, z, sx, h - below - 1, sz, a[0], Dirt);
+                    pos += run;
+                }
+            }
+        }
+        out.min_y = min_y;
+        out.max_y = max_y;
+    }
+
+    // quadtree walk over the tiles around (x, z): every top level tile within `horizon` blocks, split into its
+    // four children while closer than `near` * 2^(level - 1) blocks and all four are ready; level 0 children are chunks
+    // NOTE: whatever is ready, no column is drawn by two leaves, and tiles still building leave the only gaps
+    struct Walk {
+        std::function<bool(int, int, int)> ready;  // level, tx, tz has a mesh
+        std::function<void(int, int, int)> want;   // level, tx, tz is in use: keep it, or build it when not ready
+        std::function<void(int, int, int)> leaf;   // level, tx, tz is drawn
+
+        void run(float x, float z, float near, float horizon) {
+            int r = (int)ceilf(horizon / span(LEVELS)) + 1;
+            int px = tile_of((int)floorf(x), LEVELS), pz = tile_of((int)floorf(z), LEVELS);
+            for (int tx = px - r; tx <= px + r; tx++) {
+                for (int tz = pz - r; tz <= pz + r; tz++) {
+                    if (distance(LEVELS, tx, tz, x, z) > horizon) continue;
+                    want(LEVELS, tx, tz);
+                    visit(LEVELS, tx, tz, x, z, near);
+                }
+            }
+        }
+
+        void visit(int level, int tx, int tz, float x, float z, float near) {
+            if (level > 0 && distance(level, tx, tz, x, z) < near * (1 << (level - 1))) {
+                bool split = true;
+                for (int c = 0; c < 4; c++) {
+                    int cx = tx * 2 + (c & 1), cz = tz * 2 + (c >> 1);
+                    want(level - 1, cx, cz);
+                    split = split && ready(level - 1, cx, cz);
+                }
+                if (split) {
+                    for (int c = 0; c < 4; c++) visit(level - 1, tx * 2 + (c & 1), tz * 2 + (c >> 1), x, z, near);
+                    return;
+                }
+            }
+            if (level == 0 || ready(level, tx, tz)) leaf(level, tx, tz);
+        }
+    };
+}
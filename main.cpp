@@ -1,7 +1,11 @@
 #include <cstdlib>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <cmath>
 
@@ -11,277 +15,375 @@
 #include "perlin.cpp"
 #include "camera.cpp"
 #include "model.cpp"
+#include "world.cpp"
+#include "raycast.cpp"
+#include "stream.cpp"
+#include "lod.cpp"
+#include "occlusion.cpp"
+#include "profile.cpp"
+#include "jobs.cpp"
+#include "input.cpp"
+#include "sim.cpp"
+#include "render.cpp"
+#include "tick.cpp"
 
 Vector3 P3(float x, float y, float z);
 Vector2 P2(float x, float y);
 Vector3 P3(int x, int y, int z);
 Vector2 P2(int x, int y);
 
-const float CUBE = 1.f;
-const float CAM_HEIGHT = 4 * CUBE;
-const float JUMP_HEIGHT = 2 * CUBE;
-
-enum CubeType { Dirt, Stone, Grass };
-
-struct Cube {
-    Vector3 position;
-    Vector3 scales = P3(CUBE, CUBE, CUBE);
-    Color color = BLACK;
-    CubeType type = CubeType::Dirt;
-};
-
-struct Jump {
-    float jumped_at = -1;
-    float min_tall = 0;
-
-    bool in_jump() { return this->jumped_at != -1; }
-
-    float f(float t) {
-        if (!this->in_jump()) return 0;
-        float b = 2 * JUMP_HEIGHT / t;
-        float a = -b / 2*t; 
-        float ft = (a * pow(t, 2.0f)) + (b * t);
-        if (ft <= 0) {
-            this->jumped_at = -1;
-            this->min_tall = 0;
-            ft = 0;
-        }
-        return ft;
+// streamed map, generated around the player as it moves
+const int LOAD_RADIUS = 8;           // chunks kept loaded around the player
+const double STREAM_BUDGET = 0.004;  // seconds per tick for taking in finished work, and again for snapshotting chunks to mesh
+world::ColumnCache columnCache;
+sim::Game game;
+world::World &level = game.level;
+
+// static chunk meshes, rebuilt only when their blocks change
+std::unordered_map<long long, ChunkModel> models;
+std::unordered_map<long long, ChunkModel> lodModels;  // by lod::key, coarse tiles past the full detail chunks
+const float LOD_HORIZON = 512;                        // blocks, lod tiles are drawn out to here
+atlas::Atlas blockAtlas;
+
+void unloadChunkModel(int cx, int cz) {
+    auto it = models.find(world::key(cx, cz));
+    if (it == models.end()) return;
+    UnloadChunkModel(it->second);
+    models.erase(it);
+}
+
+// this frame's keys and mouse, the mouse as movement since the last frame
+input::Input readInput(Vector2 &lastMouse) {
+    input::Input in;
+    in.dt = GetFrameTime();
+    Vector2 mouse = GetMousePosition();
+    in.mouse[0] = mouse.x - lastMouse.x;
+    in.mouse[1] = mouse.y - lastMouse.y;
+    lastMouse = mouse;
+
+    const struct { int key; input::Button button; } keys[] = {
+        {KEY_W, input::Forward}, {KEY_S, input::Back}, {KEY_D, input::Right}, {KEY_A, input::Left},
+        {KEY_SPACE, input::Jump}, {KEY_LEFT_SHIFT, input::Slow}, {KEY_R, input::Respawn}, {KEY_F, input::FreeObserve},
+        {KEY_ONE, input::Mark}, {KEY_G, input::Fill}, {KEY_C, input::Copy}, {KEY_V, input::Paste}, {KEY_Z, input::Undo}
+    };
+    for (const auto &k : keys) {
+        if (IsKeyDown(k.key)) in.down |= k.button;
+        if (IsKeyPressed(k.key)) in.pressed |= k.button;
     }
+    const struct { int mouse; input::Button button; } buttons[] = {
+        {MOUSE_BUTTON_LEFT, input::Break}, {MOUSE_BUTTON_RIGHT, input::Place}, {MOUSE_BUTTON_MIDDLE, input::PlaceLamp}
+    };
+    for (const auto &b : buttons) {
+        if (IsMouseButtonDown(b.mouse)) in.down |= b.button;
+        if (IsMouseButtonPressed(b.mouse)) in.pressed |= b.button;
+    }
+    return in;
+}
 
-    void start_jump(Camera3D &cam, float tallest_y) {
-        if (this->in_jump()) return;
-        this->jumped_at = GetTime();
-        this->min_tall = tallest_y;
+int main(int argc, char **argv)
+{
+    int scrWidth = 800, scrHeight = 600;
+
+    // ./raycraft.out [seed] [--record file | --replay file], every seed is saved to its own directory
+    // NOTE: recorded and replayed sessions start from a freshly generated world and are not saved
+    int seed = perlin::SEED;
+    const char *record = nullptr, *replay = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--record") && i + 1 < argc) record = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc) replay = argv[++i];
+        else seed = atoi(argv[i]);
     }
 
-    void update_jump(Camera &cam, float tallest_y = 0) {
-        if (!this->in_jump()) return;
-        cam.position.y = this->min_tall + CAM_HEIGHT + this->f(GetTime() - this->jumped_at);
-        // height check
-        if ((cam.position.y - CAM_HEIGHT) < tallest_y) {
-            cam.position.y = tallest_y + CAM_HEIGHT;
-            this->jumped_at = -1;
-            this->min_tall = 0;
-            return;
+    input::Log log;
+    if (replay) {
+        if (!log.load(replay)) {
+            fprintf(stderr, "can't read input log %s, or it was recorded by an older version\n", replay);
+            return 1;
         }
+        seed = log.header.seed;
     }
-};
-
-// static map
-const int MAP_SIZE = 250;
-std::vector<Cube> blocks;
-void populateMap() {
-    // random map generate
-    for (int xx = 0; xx < MAP_SIZE; xx++) {
-        for (int yy = 0; yy < MAP_SIZE; yy++) {
-            int maximum_height = 0;
-            for (int t = 0; t < (int)(perlin::perlin2d(xx, yy, 0.1, 1)*10); t++) {
-                if (t > maximum_height) maximum_height = t;
-                blocks.push_back(Cube {
-                    position: P3(xx, t, yy),
-                    type: t < 1 ? CubeType::Stone : CubeType::Dirt
-                });
-            }
-            blocks.push_back(Cube {
-                position: P3(xx, (int)(maximum_height + CUBE), yy),
-                type: CubeType::Grass
-            });
-        }
+    input::Recorder recorder;
+    if (record && !recorder.open(record, seed)) {
+        fprintf(stderr, "can't write input log %s\n", record);
+        return 1;
     }
-}
 
-float getTallestY(float _x, float _z, bool tallest = true) {
-    float r = -1.0f;
-    int px = _x, pz = _z;
-    for (const auto blk : blocks) {
-        int cx = blk.position.x;
-        int cy = blk.position.y;
-        float cz = blk.position.z;
-        // check block at that position
-        if ( px == cx && pz == cz && cy > r ) {
-            r = blk.position.y;
-            if (!tallest) break;
-        }
-    }
-    return r == -1 ? 0 : r;
-}
+    // every background job of the game runs on this one pool
+    jobs::Pool pool;
+    std::unique_ptr<region::Store> store;
+    if (!record && !replay) store.reset(new region::Store(TextFormat("./save/%i", seed), seed));
+    game.terrain.noise = perlin::Noise(seed, 4, 0.03f, 2.0f, 0.5f);
+    game.terrain.amplitude = 24;
+    game.terrain.cache = &columnCache;
 
-int main()
-{
-    int scrWidth = 800, scrHeight = 600;
     SetTraceLogLevel(TraceLogLevel::LOG_WARNING);
     InitWindow(scrWidth, scrHeight, "Game");
 
-    Image img0 = LoadImage("./res/dirt_block.png");
-    Image img1 = LoadImage("./res/stone_block.png");
-    Image img3 = LoadImage("./res/grass_block.png");
-
-    Texture DirtCubeTexture = LoadTextureFromImage(img0);
-    Texture StoneCubeTexture = LoadTextureFromImage(img1);
-
-    Image i_front = ImageFromImage(img3, Rectangle { x: 0,y: 0, width: 16, height: 16 });
-    Image i_back = ImageFromImage(img3, Rectangle { x: 16,y: 0, width: 16, height: 16 });
-    Image i_top = ImageFromImage(img3, Rectangle { x: 32,y: 0, width: 16, height: 16 });
-    Image i_bottom = ImageFromImage(img3, Rectangle { x: 48,y: 0, width: 16, height: 16 });
-    Image i_right = ImageFromImage(img3, Rectangle { x: 64,y: 0, width: 16, height: 16 });
-    Image i_left = ImageFromImage(img3, Rectangle { x: 80,y: 0, width: 16, height: 16 });
-
-    Texture t_front = LoadTextureFromImage(i_front);
-    Texture t_back = LoadTextureFromImage(i_back);
-    Texture t_top = LoadTextureFromImage(i_top);
-    Texture t_bottom = LoadTextureFromImage(i_bottom);
-    Texture t_right = LoadTextureFromImage(i_right);
-    Texture t_left = LoadTextureFromImage(i_left);
-
-    unsigned int GrassCubeTexture[6] = {
-        t_front.id, t_back.id,
-        t_top.id, t_bottom.id,
-        t_right.id, t_left.id
-    };
+    Image img0 = LoadImage(TextFormat("%s/dirt_block.png", render::RESOURCES));
+    Image img1 = LoadImage(TextFormat("%s/stone_block.png", render::RESOURCES));
+    Image img3 = LoadImage(TextFormat("%s/grass_block.png", render::RESOURCES));
 
-    UnloadImage(img0);
-    UnloadImage(img1);
+    // indexed by mesher::tile, the grass strip holds front, back, top, bottom, right, left; the lamp has no png
+    Image tiles[mesher::TILE_COUNT] = { img0, img1 };
+    for (int i = 0; i < 6; i++) tiles[2 + i] = ImageFromImage(img3, Rectangle { x: 16.f * i, y: 0, width: 16, height: 16 });
+    png::Image lampTile;
+    render::lamp(lampTile);
+    tiles[8] = ImageCopy(Image { lampTile.rgba.data(), lampTile.width, lampTile.height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 });
+
+    // everything is drawn from one atlas texture and material
+    blockAtlas = atlas::Load(tiles);
+
+    for (Image &img : tiles) UnloadImage(img);
     UnloadImage(img3);
 
-    populateMap();
+    stream::Streamer streamer(pool, &game.terrain, LOAD_RADIUS);
+    streamer.store = store.get();
+    game.load_spawn(streamer, store.get());
 
-    Jump jm;
+    const sim::Player &player = game.player;
     Camera3D C = {
-        position : P3(MAP_SIZE / 2.0f, CAM_HEIGHT, MAP_SIZE / 2.0f),
-        target : P3(0, 0, 0),
-        up : P3(0.f, CAM_HEIGHT, 0.f),
+        position : P3(player.position[0], player.position[1], player.position[2]),
+        target : P3(player.target[0], player.target[1], player.target[2]),
+        up : P3(0.f, sim::CAM_HEIGHT, 0.f),
         fovy : 60.0f,
         projection : CameraProjection::CAMERA_PERSPECTIVE
     };
 
+    // the game steps on its own thread from here on, see tick.cpp
+    tick::Runner runner(game, streamer);
+    runner.budget = STREAM_BUDGET;
+    if (record) runner.recorder = &recorder;
+    if (replay) runner.replay = &log;
+    runner.start();
+    tick::State before, after;  // the last two ticks, the frame is drawn between them
+    std::vector<tick::Update> updates;
+
     EnableFirstPerson(C);
     SetTargetFPS(60);
+    Vector2 lastMouse = GetMousePosition();
 
-    float speed, pointer_dm;
-    bool free_observe = false;
-    float tallest_y = 0;
+    float pointer_dm;
     int draw_distance = 15;
-    int drawn_blocks = 0;
-    float respawn_msg = 0.0f;
-    Ray mray;
-
-    C.position.y = getTallestY(C.position.x, C.position.z) + CAM_HEIGHT;
-
-    while (!WindowShouldClose())
+    int tested_chunks = 0, culled_chunks = 0, occluded_chunks = 0, drawn_chunks = 0, drawn_triangles = 0, drawn_tiles = 0;
+    bool use_lod = true;
+    bool use_occlusion = true;
+    occlusion::Walk sight;  // chunks seen through open air from the camera this frame
+    std::vector<std::pair<int, const ChunkModel *>> visible;  // lod level and model of what is drawn this frame
+    std::unordered_set<long long> wantedTiles;
+    bool show_profile = false;
+    float trace_msg = -10.0f;
+    bool trace_saved = false;
+    std::unique_ptr<render::Renderer> shotRenderer;  // started on the first F2
+    render::Textures shotTextures;
+    float shot_msg = -10.0f;
+    bool shot_saved = false;
+
+    while (!WindowShouldClose() && !runner.finished)
     {
+        profile::frame();
+
         //draw distance control
-        if (IsKeyPressed(KEY_KP_ADD)) draw_distance++; //draw_distance += CAM_HEIGHT;
-        if (IsKeyPressed(KEY_KP_SUBTRACT) && draw_distance > CAM_HEIGHT) draw_distance--; //draw_distance -= 1;
+        if (IsKeyPressed(KEY_KP_ADD) && draw_distance < (LOAD_RADIUS - 1) * world::CHUNK_SIZE) draw_distance++; //draw_distance += CAM_HEIGHT;
+        if (IsKeyPressed(KEY_KP_SUBTRACT) && draw_distance > sim::CAM_HEIGHT) draw_distance--; //draw_distance -= 1;
 
-        // highest y in current (x,z)
-        tallest_y = getTallestY(C.position.x, C.position.z);
+        // the tick thread takes the input on its next tick, a replay steps through the log there instead
+        input::Input in = readInput(lastMouse);
+        if (!replay) runner.push(in);
 
-        if ( !free_observe && ((int)tallest_y == 0) || IsKeyPressed(KEY_R)) {
-            C.position.x = C.position.z = (int)MAP_SIZE / 2.0f;
-            C.position.y = tallest_y = getTallestY(C.position.x, C.position.z);
-            respawn_msg = GetTime();
+        // meshes the ticks since the last frame made, and chunks they unloaded
+        runner.take(before, after, updates);
+        {
+            PROFILE_SCOPE("upload");
+            for (tick::Update &u : updates) {
+                if (!u.mesh) unloadChunkModel(u.cx, u.cz);
+                else if (u.mesh->lod) UploadChunkModel(lodModels[lod::key(u.mesh->lod, u.cx, u.cz)], *u.mesh, blockAtlas);
+                else UploadChunkModel(models[world::key(u.cx, u.cz)], *u.mesh, blockAtlas);
+            }
+            updates.clear();
         }
 
-        // toggle free observe mode
-        if (IsKeyPressed(KEY_F)) free_observe = !free_observe;
+        if (IsKeyPressed(KEY_F5) && store) {
+            std::lock_guard<std::mutex> guard(runner.world_lock);
+            store->save(level);
+        }
+        if (IsKeyPressed(KEY_L)) use_lod = !use_lod;
+        if (IsKeyPressed(KEY_O)) use_occlusion = !use_occlusion;
+
+        // frame profiler overlay, and the last frames of every thread as a chrome trace
+        if (IsKeyPressed(KEY_F3)) show_profile = !show_profile;
+        if (IsKeyPressed(KEY_F4)) {
+            trace_saved = profile::dump("./trace.json");
+            trace_msg = GetTime();
+        }
 
-        pointer_dm = IsMouseButtonDown(MOUSE_BUTTON_LEFT) ? 4 : 1.5;
-        speed = IsKeyDown(KEY_LEFT_SHIFT) ? 3 : 5;
+        // one tick behind the latest, moved along between the last two by the time since the latest
+        pointer_dm = (in.down & input::Break) ? 4 : 1.5;
+        {
+            float t = Clamp((float)((tick::clock() - after.at) / input::FIXED_DT), 0, 1), position[3], target[3];
+            tick::blend(before, after, t, position, target);
+            C.position = P3(position[0], position[1], position[2]);
+            C.target = P3(target[0], target[1], target[2]);
+        }
 
-        if (IsKeyPressed(KEY_SPACE) && !jm.in_jump()) jm.start_jump(C, tallest_y);
+        // the current view from the CPU renderer, what headless previews and golden images are drawn with
+        if (IsKeyPressed(KEY_F2)) {
+            if (!shotRenderer) {
+                shotRenderer.reset(new render::Renderer(pool));
+                shotTextures.load(render::RESOURCES);
+            }
+            std::lock_guard<std::mutex> guard(runner.world_lock);
+            shotRenderer->draw(level, render::view(C, draw_distance), shotTextures, GetScreenWidth(), GetScreenHeight());
+            shot_saved = png::save("./shot.png", shotRenderer->frame);
+            shot_msg = GetTime();
+        }
 
-        // if there is an active jump action
-        if (jm.in_jump()) jm.update_jump(C, tallest_y);
-        
-        //  check for the least possible y
-        //  keep him on the highest ground if character is not jumping
-        if (!free_observe && !jm.in_jump() && (C.position.y < CAM_HEIGHT || C.position.y > CAM_HEIGHT)) {
-            C.position.y = CAM_HEIGHT + tallest_y;
+        // full detail chunks near the player, and with lod the coarse tiles around them out to the horizon
+        visible.clear();
+        if (use_lod) {
+            PROFILE_SCOPE("lod");
+            wantedTiles.clear();
+            lod::Walk walk;
+            walk.ready = [](int lv, int tx, int tz) {
+                return lv ? lodModels.count(lod::key(lv, tx, tz)) > 0 : models.count(world::key(tx, tz)) > 0;
+            };
+            walk.want = [&](int lv, int tx, int tz) {
+                if (!lv) return;
+                long long k = lod::key(lv, tx, tz);
+                wantedTiles.insert(k);
+                if (!lodModels.count(k)) runner.want(lv, tx, tz);
+            };
+            walk.leaf = [&](int lv, int tx, int tz) {
+                visible.push_back({lv, lv ? &lodModels.at(lod::key(lv, tx, tz)) : &models.at(world::key(tx, tz))});
+            };
+            walk.run(C.position.x, C.position.z, draw_distance, LOD_HORIZON);
+
+            // tiles that left the tree
+            for (auto it = lodModels.begin(); it != lodModels.end();) {
+                if (wantedTiles.count(it->first)) {
+                    it++;
+                    continue;
+                }
+                UnloadChunkModel(it->second);
+                it = lodModels.erase(it);
+            }
+        } else {
+            int ccx = world::chunk_of(floorf(C.position.x)), ccz = world::chunk_of(floorf(C.position.z));
+            int reach = draw_distance / world::CHUNK_SIZE + 1;
+            for (int cx = ccx - reach; cx <= ccx + reach; cx++)
+            for (int cz = ccz - reach; cz <= ccz + reach; cz++)
+            {
+                auto it = models.find(world::key(cx, cz));
+                if (it == models.end()) continue;
+                const ChunkModel &model = it->second;
+                float nx = Clamp(C.position.x, model.bounds.min.x, model.bounds.max.x);
+                float nz = Clamp(C.position.z, model.bounds.min.z, model.bounds.max.z);
+                if (Vector2Distance(P2(nx, nz), P2(C.position.x, C.position.z)) <= draw_distance) visible.push_back({0, &model});
+            }
         }
 
-        FirstPersonCamera(&C, false, speed);
-        //lastpos = C.position;
+        // full detail chunks the camera can't see through air, walked over the chunk sections in the view frustum
+        Frustum frustum = CameraFrustum(C, (float)GetScreenWidth() / GetScreenHeight());
+        if (use_occlusion) {
+            PROFILE_SCOPE("occlusion");
+            sight.graph = [](int cx, int cz) -> const occlusion::Graph * {
+                auto it = models.find(world::key(cx, cz));
+                return it == models.end() ? nullptr : &it->second.graph;
+            };
+            sight.inside = [&frustum](int cx, int s, int cz) {
+                float x = cx * world::CHUNK_SIZE, y = s * occlusion::SECTION, z = cz * world::CHUNK_SIZE;
+                return FrustumContainsBox(frustum, BoundingBox { P3(x, y, z), P3(x + world::CHUNK_SIZE, y + occlusion::SECTION, z + world::CHUNK_SIZE) });
+            };
+            sight.run(C.position.x, C.position.y, C.position.z, LOAD_RADIUS, after.pocket);
+        }
 
         BeginDrawing();
         {
             ClearBackground(WHITE);
 
             BeginMode3D(C);
-            {                
-                mray = GetMouseRay(P2(scrWidth /2, scrHeight /2), C);
-                RayCollision col = RayCollision { hit: false };
-                bool q = true;
-                drawn_blocks = 0;
-                int index = 0;
-                for (const auto cb : blocks)
-                {
-                    int dist = Vector3Distance(C.position, cb.position);
-
-                    if (dist > draw_distance) {
-                        index++;
+            {
+                const raycast::Hit &pick = after.pick;
+                if (pick.hit) DrawCubeWires(P3(pick.x + sim::CUBE / 2, pick.y + sim::CUBE / 2, pick.z + sim::CUBE / 2), sim::CUBE, sim::CUBE, sim::CUBE, LIGHTGRAY);
+                const edit::Box &sel = after.selection;
+                if (!sel.empty()) {
+                    float sx = sel.x1 - sel.x0 + 1, sy = sel.y1 - sel.y0 + 1, sz = sel.z1 - sel.z0 + 1;
+                    DrawCubeWires(P3(sel.x0 + sx / 2, sel.y0 + sy / 2, sel.z0 + sz / 2), sx, sy, sz, ORANGE);
+                }
+
+                // of those, only what is inside the view frustum
+                PROFILE_SCOPE("draw");
+                tested_chunks = culled_chunks = occluded_chunks = drawn_chunks = drawn_triangles = drawn_tiles = 0;
+                for (const auto &v : visible) {
+                    const ChunkModel &model = *v.second;
+                    if (model.meshes.empty()) continue;
+                    tested_chunks++;
+                    if (!FrustumContainsBox(frustum, model.bounds)) {
+                        culled_chunks++;
                         continue;
                     }
-                    Vector3 adp = P3(cb.position.x + cb.scales.y / 2,cb.position.y + cb.scales.x / 2,cb.position.z + cb.scales.z / 2);
-
-                    // dist > CAM_HEIGHT
-                    if (q && dist < 6*CUBE) {
-                        col = GetRayCollisionBox(mray, BoundingBox {
-                            min: P3(cb.position.x - cb.scales.x/2, cb.position.y - cb.scales.y/2, cb.position.z - cb.scales.z/2 ),
-                            max: P3(cb.position.x + cb.scales.x/2, cb.position.y + cb.scales.y/2, cb.position.z + cb.scales.z/2 )
-                        });
-                        if (
-                            col.hit &&
-                            (int)floor(mray.direction.x) == 0 &&
-                            ((int)(mray.direction.y)) <= -1.1 &&
-                            (int)floor(mray.direction.z) == 0
-                        ) {
-                            DrawCubeWires(P3(C.position.x, tallest_y, C.position.z), CUBE, CUBE, CUBE, LIGHTGRAY);
-                        }
-                        q = !col.hit;
-                    }
-					Color c = WHITE;
-                    if (col.hit) {
-                        DrawCubeWires(adp, CUBE, CUBE,CUBE, LIGHTGRAY);
-						c = LIGHTGRAY;
-                        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && cb.type != CubeType::Stone) {
-                            blocks.erase(blocks.begin() + index);
-                        }
-                        if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
-                            blocks.push_back(Cube {
-                                position: P3(cb.position.x, cb.position.y + CUBE, cb.position.z)
-                            });
-                        }
-                    }
-                    switch (cb.type) {                    
-                        case CubeType::Dirt: DrawCubeTexture(DirtCubeTexture, adp, CUBE, CUBE, CUBE, c); break;
-                        case CubeType::Stone: DrawCubeTexture(StoneCubeTexture, adp, CUBE, CUBE, CUBE, c); break;
-                        case CubeType::Grass: CUSTOM_DrawCubeTexture(GrassCubeTexture, adp, CUBE, CUBE, CUBE, c); break;
-                        default: DrawCube(adp, cb.scales.x, cb.scales.y, cb.scales.z, LIGHTGRAY); break;
+                    if (!v.first && use_occlusion && !sight.reached(world::chunk_of((int)model.bounds.min.x), world::chunk_of((int)model.bounds.min.z))) {
+                        occluded_chunks++;
+                        continue;
                     }
 
-                    if (!q) col.hit = false;
-
-                    drawn_blocks++;
-                    index++;
+                    DrawChunkModel(model, blockAtlas);
+                    if (v.first) drawn_tiles++;
+                    else drawn_chunks++;
+                    drawn_triangles += model.triangles;
                 }
             }
             EndMode3D();
 
-            DrawText(TextFormat("P{x: %.2f, y: %.2f, z: %.2f}\nT{x: %.2f, y: %.2f, z: %.2f}\nSpeed: %.1f\nBlocks: %i of %i\nDistance: %i", C.position.x, C.position.y, C.position.z, C.target.x, C.target.y, C.target.z, speed, drawn_blocks, blocks.size(), draw_distance), 20, 20, 8, GRAY);
+            PROFILE_SCOPE("hud");
+            DrawText(TextFormat("P{x: %.2f, y: %.2f, z: %.2f}\nT{x: %.2f, y: %.2f, z: %.2f}\nSpeed: %.1f\nBlocks: %i\nChunks: %i tested, %i culled, %i occluded, %i drawn of %i\nOcclusion: %s\nLOD: %s, %i tiles drawn of %i\nTriangles: %i\nDistance: %i\nSeed: %i\nLoaded: %i chunks, %i pending\nSaved: %i loaded, %i written\nEdits: %i to undo, %i to redo, %i KB\nTick: %i, input %.1f ms", C.position.x, C.position.y, C.position.z, C.target.x, C.target.y, C.target.z, after.speed, after.blocks, tested_chunks, culled_chunks, occluded_chunks, drawn_chunks, (int)models.size(), use_occlusion ? "on" : "off", use_lod ? "on" : "off", drawn_tiles, (int)lodModels.size(), drawn_triangles, draw_distance, seed, after.chunks, after.pending, store ? (int)store->loaded : 0, store ? (int)store->saved : 0, after.undo, after.redo, (int)(after.journal_bytes >> 10), (int)after.tick, after.input_ms), 20, 20, 8, GRAY);
             DrawText(TextFormat("%i fps", GetFPS()), (scrWidth / 2) - 20, 10, 10, BLACK);
 
             DrawCircle(scrWidth / 2, scrHeight / 2, pointer_dm, ColorAlpha(BLACK, 0.3));
-            if (free_observe) DrawText("FREE OBSERVER MODE", 20, scrHeight - 20, 10, RED);
-            if (jm.in_jump()) DrawText("JUMP", scrWidth - 40, 10, 10, RED);
-            if ( (GetTime() - respawn_msg) < 3) {
+            if (after.free_observe) DrawText("FREE OBSERVER MODE", 20, scrHeight - 20, 10, RED);
+            if (after.jumping) DrawText("JUMP", scrWidth - 40, 10, 10, RED);
+            if (replay) DrawText(TextFormat("REPLAY %i/%i", (int)after.tick, (int)log.frames.size()), 20, scrHeight - 60, 10, RED);
+            else if (record) DrawText(TextFormat("RECORDING %i", (int)after.tick), 20, scrHeight - 60, 10, RED);
+            if (after.respawning) {
                 DrawRectangle(0,0,scrWidth, scrHeight, ColorAlpha(BLACK, 0.3));
                 DrawText("RESPAWN", (scrWidth / 2) - 50, scrHeight / 2, 25, RED);
             }
+            if ((GetTime() - trace_msg) < 2) DrawText(trace_saved ? "TRACE SAVED TO ./trace.json" : "TRACE NOT SAVED", 20, scrHeight - 40, 10, RED);
+            if ((GetTime() - shot_msg) < 2) DrawText(shot_saved ? "SHOT SAVED TO ./shot.png" : "SHOT NOT SAVED", 20, scrHeight - 80, 10, RED);
+
+            // per stage ms over the last 600 frames, the tick thread's by the frame they ended in; the first line is the whole frame
+            if (show_profile) {
+                std::vector<profile::Stat> stats = profile::stats();
+                int x = scrWidth - 220, y = 30;
+                DrawRectangle(x - 10, y - 5, 220, 20 + 12 * (int)stats.size(), ColorAlpha(BLACK, 0.6));
+                DrawText("stage        avg     p99    last", x, y, 10, WHITE);
+                for (const profile::Stat &st : stats) {
+                    y += 12;
+                    DrawText(TextFormat("%-10s %6.2f  %6.2f  %6.2f", st.name, st.avg, st.p99, st.last), x, y, 10, WHITE);
+                }
+
+                // queued jobs and ms from queued to started of every kind of job, since the start
+                y += 30;
+                DrawRectangle(x - 10, y - 5, 220, 20 + 12 * pool.channel_count, ColorAlpha(BLACK, 0.6));
+                DrawText("jobs       queued  wait   max", x, y, 10, WHITE);
+                for (int ch = 0; ch < pool.channel_count; ch++) {
+                    jobs::Stats js = pool.stats(ch);
+                    y += 12;
+                    DrawText(TextFormat("%-10s %6i  %6.2f  %6.2f", js.name, js.depth, js.wait_avg, js.wait_max), x, y, 10, WHITE);
+                }
+            }
+        }
+        {
+            PROFILE_SCOPE("present");
+            EndDrawing();
         }
-        EndDrawing();
     }
 
+    runner.stop();
+    if (store) store->save(level);
+    recorder.close();
+    for (auto &it : models) UnloadChunkModel(it.second);
+    for (auto &it : lodModels) UnloadChunkModel(it.second);
+    atlas::Unload(blockAtlas);
     CloseWindow();
     return 0;
 }
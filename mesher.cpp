@@ -0,0 +1,231 @@
+// Chunk mesher, hidden face removal and greedy quad merging
+// NOTE: no raylib in here, meshes can be built and counted headless
+#pragma once
+#include <vector>
+#include "light.cpp"
+#include "occlusion.cpp"
+#include "world.cpp"
+
+namespace mesher
+{
+    // same order as the grass texture strip
+    enum Face { Front = 0, Back, Top, Bottom, Right, Left };
+
+    const int FACE_NORMAL[6][3] = {{0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}};
+    const int FACE_AXIS[6] = {2, 2, 1, 1, 0, 0};    // axis the face points along
+    const int FACE_U_AXIS[6] = {0, 0, 0, 0, 2, 2};  // axis the texture u runs along
+    const int FACE_V_AXIS[6] = {1, 1, 2, 2, 1, 1};  // axis the texture v runs along
+
+    // unit cube corners (counter clockwise seen from outside) and their uvs
+    const float FACE_CORNERS[6][4][3] = {
+        {{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}},  // Front
+        {{0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}},  // Back
+        {{0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {1, 1, 0}},  // Top
+        {{0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1}},  // Bottom
+        {{1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}},  // Right
+        {{0, 0, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 0}}   // Left
+    };
+    const float FACE_UVS[6][4][2] = {
+        {{0, 0}, {1, 0}, {1, 1}, {0, 1}},
+        {{1, 0}, {1, 1}, {0, 1}, {0, 0}},
+        {{0, 1}, {0, 0}, {1, 0}, {1, 1}},
+        {{1, 1}, {0, 1}, {0, 0}, {1, 0}},
+        {{1, 0}, {1, 1}, {0, 1}, {0, 0}},
+        {{0, 0}, {1, 0}, {1, 1}, {0, 1}}
+    };
+
+    // texture tiles: dirt, stone, the six grass faces, then lamp
+    const int TILE_COUNT = 9;
+
+    // tile of every block face, indexed by CubeType then Face
+    const unsigned char BLOCK_TILES[5][6] = {
+        {0, 0, 0, 0, 0, 0},  // Air
+        {0, 0, 0, 0, 0, 0},  // Dirt
+        {1, 1, 1, 1, 1, 1},  // Stone
+        {2, 3, 4, 5, 6, 7},  // Grass
+        {8, 8, 8, 8, 8, 8}   // Lamp
+    };
+    inline int tile(CubeType t, int face) { return BLOCK_TILES[t][face]; }
+
+    // a merged face: block-space box of the quad (size is 1 along the face axis)
+    // NOTE: world coordinates, int as a streamed world has no edge
+    struct Quad {
+        int x, y, z;
+        unsigned char size[3];
+        unsigned char face, tile;
+        unsigned char light = light::OPEN;  // of the air in front, see light::colour
+        unsigned char ao = 0;               // occlusion 0-3 of each corner, 2 bits per corner in FACE_CORNERS order
+    };
+
+    inline int occlusion(const Quad &q, int corner) { return q.ao >> (corner * 2) & 3; }
+
+    // brightness of a corner by its occlusion
+    const float AO_SHADE[4] = {1.0f, 0.8f, 0.65f, 0.5f};
+
+    // split along the 1-3 diagonal instead of 0-2 when corners 0 and 2 are darker, so the two triangles
+    // shade the same way whichever way the quad is turned
+    inline bool flipped(const Quad &q) { return occlusion(q, 0) + occlusion(q, 2) > occlusion(q, 1) + occlusion(q, 3); }
+
+    struct ChunkMesh {
+        int cx = 0, cz = 0;
+        int lod = 0;               // 0 for a chunk, else the level of a lod tile and cx, cz are tile coordinates
+        int min_y = 0, max_y = 0;  // vertical extent of the quads
+        std::vector<Quad> quads;
+        occlusion::Graph graph;    // which section faces see each other, all open for lod tiles and empty chunks
+
+        int vertex_count() const { return quads.size() * 4; }
+        int triangle_count() const { return quads.size() * 2; }
+    };
+
+    // world-space corners, uvs (in blocks, so textures repeat) and normal of a quad
+    inline void vertices(const Quad &q, float pos[12], float uv[8], float normal[3]) {
+        const float origin[3] = {(float)q.x, (float)q.y, (float)q.z};
+        int ua = FACE_U_AXIS[q.face], va = FACE_V_AXIS[q.face];
+        for (int i = 0; i < 4; i++) {
+            for (int a = 0; a < 3; a++) pos[i * 3 + a] = origin[a] + FACE_CORNERS[q.face][i][a] * q.size[a];
+            uv[i * 2 + 0] = FACE_UVS[q.face][i][0] * q.size[ua];
+            uv[i * 2 + 1] = FACE_UVS[q.face][i][1] * q.size[va];
+        }
+        for (int a = 0; a < 3; a++) normal[a] = FACE_NORMAL[q.face][a];
+    }
+
+    // build the faces of chunk (cx, cz) that touch air, greedy merges coplanar faces of the same tile, light and
+    // corner occlusion; `ao` off leaves every corner open
+    // NOTE: a corner's occlusion counts the two blocks beside it and the one diagonal to it in front of the
+    // face, both beside makes it 3 whatever the diagonal is
+    void build(const world::World &w, int cx, int cz, ChunkMesh &out, bool greedy = true, bool ao = true) {
+        using namespace world;
+        out.cx = cx;
+        out.cz = cz;
+        out.quads.clear();
+        out.min_y = CHUNK_HEIGHT;
+        out.max_y = 0;
+        out.graph.open();
+
+        const Chunk *c = w.chunk(cx, cz);
+        if (!c || !c->solid) return;
+        occlusion::connect(*c, out.graph);
+
+        // nothing above the highest column can have a face, the scan stops there
+        int top = 0;
+        for (short h : c->height) top = h > top ? h : top;
+        const int dims[3] = {CHUNK_SIZE, top + 1, CHUNK_SIZE};
+        const int bx = cx * CHUNK_SIZE, bz = cz * CHUNK_SIZE;
+        static thread_local std::vector<unsigned> mask;
+
+        // the chunk and the ring of blocks around it that faces and corners look at, from a row below the
+        // scan to a row above it: solid or not in a padded grid, and the chunk each column is in
+        const Chunk *ring[3][3];
+        for (int dz = 0; dz < 3; dz++)
+            for (int dx = 0; dx < 3; dx++) ring[dz][dx] = w.chunk(cx + dx - 1, cz + dz - 1);
+        auto column = [&](int x, int z, int &lx, int &lz) {
+            int rx = x < 0 ? 0 : x < CHUNK_SIZE ? 1 : 2, rz = z < 0 ? 0 : z < CHUNK_SIZE ? 1 : 2;
+            lx = x - (rx - 1) * CHUNK_SIZE;
+            lz = z - (rz - 1) * CHUNK_SIZE;
+            return ring[rz][rx];
+        };
+        const int X = CHUNK_SIZE + 2, stride[3] = {1, X * X, X};  // along x, y, z
+        static thread_local std::vector<unsigned char> grid;
+        grid.assign(X * X * (top + 3), 0);
+        for (int y = 0; y <= top + 1 && y < CHUNK_HEIGHT; y++) {
+            for (int z = -1; z <= CHUNK_SIZE; z++) {
+                for (int x = -1; x <= CHUNK_SIZE; x++) {
+                    int lx, lz;
+                    const Chunk *k = column(x, z, lx, lz);
+                    grid[(y + 1) * stride[1] + (z + 1) * X + x + 1] = k && k->get(lx, y, lz) != Air;
+                }
+            }
+        }
+
+        for (int f = 0; f < 6; f++) {
+            int n = FACE_AXIS[f], ua = FACE_U_AXIS[f], va = FACE_V_AXIS[f];
+            int du = dims[ua], dv = dims[va];
+            mask.assign(du * dv, 0);
+
+            // grid steps from the cell in front of a face to the blocks beside and diagonal to each corner
+            int side[4][2];
+            for (int k = 0; k < 4; k++) {
+                side[k][0] = (FACE_CORNERS[f][k][ua] > 0 ? 1 : -1) * stride[ua];
+                side[k][1] = (FACE_CORNERS[f][k][va] > 0 ? 1 : -1) * stride[va];
+            }
+
+            for (int s = 0; s < dims[n]; s++) {
+                // mask of exposed faces in this slice, ao << 16 | light << 8 | tile + 1, or 0
+                int p[3];
+                p[n] = s;
+                bool any = false;
+                for (int j = 0; j < dv; j++) {
+                    p[va] = j;
+                    for (int i = 0; i < du; i++) {
+                        p[ua] = i;
+                        unsigned m = 0;
+                        CubeType t = c->get(p[0], p[1], p[2]);
+                        if (t != Air) {
+                            int nx = p[0] + FACE_NORMAL[f][0], ny = p[1] + FACE_NORMAL[f][1], nz = p[2] + FACE_NORMAL[f][2];
+                            int front = (ny + 1) * stride[1] + (nz + 1) * X + nx + 1;
+                            if (!grid[front]) {
+                                unsigned char l = light::OPEN;
+                                if (ny < 0) l = light::BURIED;
+                                else if (ny < CHUNK_HEIGHT) {
+                                    int lx, lz;
+                                    const Chunk *k = column(nx, nz, lx, lz);
+                                    if (k) l = k->light[index(lx, ny, lz)];
+                                }
+                                // emitters are as bright as what they give off
+                                if (light::emission(t) > light::get(l, light::BLOCK)) light::put(l, light::BLOCK, light::emission(t));
+                                m = l << 8 | (tile(t, f) + 1);
+
+                                unsigned char occluded = 0;
+                                for (int k = 0; ao && k < 4; k++) {
+                                    int s1 = grid[front + side[k][0]], s2 = grid[front + side[k][1]];
+                                    int o = s1 & s2 ? 3 : s1 + s2 + grid[front + side[k][0] + side[k][1]];
+                                    occluded |= o << (k * 2);
+                                }
+                                m |= occluded << 16;
+                            }
+                        }
+                        mask[j * du + i] = m;
+                        any |= m != 0;
+                    }
+                }
+                if (!any) continue;
+
+                // merge runs along u, then grow the run along v while the whole row matches
+                for (int j = 0; j < dv; j++) {
+                    for (int i = 0; i < du;) {
+                        unsigned m = mask[j * du + i];
+                        if (!m) { i++; continue; }
+
+                        int wu = 1, hv = 1;
+                        if (greedy) {
+                            while (i + wu < du && mask[j * du + i + wu] == m) wu++;
+                            for (; j + hv < dv; hv++) {
+                                int k = 0;
+                                while (k < wu && mask[(j + hv) * du + i + k] == m) k++;
+                                if (k < wu) break;
+                            }
+                        }
+                        for (int l = 0; l < hv; l++)
+                            for (int k = 0; k < wu; k++) mask[(j + l) * du + i + k] = 0;
+
+                        Quad q;
+                        int o[3];
+                        o[n] = s; o[ua] = i; o[va] = j;
+                        q.x = bx + o[0];
+                        q.y = o[1];
+                        q.z = bz + o[2];
+                        q.size[n] = 1; q.size[ua] = wu; q.size[va] = hv;
+                        q.face = f;
+                        q.tile = (m & 0xff) - 1;
+                        q.light = m >> 8 & 0xff;
+                        q.ao = m >> 16;
+                        out.quads.push_back(q);
+                        if (q.y < out.min_y) out.min_y = q.y;
+                        if (q.y + q.size[1] > out.max_y) out.max_y = q.y + q.size[1];
+                        i += wu;
+                    }
+                }
+            }
+        }
+    }
+}
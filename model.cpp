@@ -1,77 +1,86 @@
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #include "raylib/include/raylib.h"
 #include "raylib/include/raymath.h"
 #include "raylib/include/rlgl.h"
+#include "mesher.cpp"
+#include "atlas.cpp"
 
-void CUSTOM_DrawCubeTexture(unsigned int T[6], Vector3 position, float width, float height, float length, Color color) {
-    float x = position.x, y = position.y, z = position.z;
-    rlCheckRenderBatchLimit(36);
+// GPU side of a mesher::ChunkMesh, static meshes drawn with the atlas material
+// NOTE: raylib meshes use 16-bit indices, big chunks are split over several meshes
 
-    rlSetTexture(T[0]);
-	rlBegin(RL_QUADS);
-		rlColor4ub(color.r, color.g, color.b, color.a);
-		// Front Face
-		rlNormal3f(0.0f, 0.0f, 1.0f);                  // Normal Pointing Towards Viewer
-		rlTexCoord2f(0.0f, 0.0f); rlVertex3f(x - width/2, y - height/2, z + length/2);  // Bottom Left Of The Texture and Quad
-		rlTexCoord2f(1.0f, 0.0f); rlVertex3f(x + width/2, y - height/2, z + length/2);  // Bottom Right Of The Texture and Quad
-		rlTexCoord2f(1.0f, 1.0f); rlVertex3f(x + width/2, y + height/2, z + length/2);  // Top Right Of The Texture and Quad
-		rlTexCoord2f(0.0f, 1.0f); rlVertex3f(x - width/2, y + height/2, z + length/2);  // Top Left Of The Texture and Quad
-	rlEnd();
-    
-	rlSetTexture(T[1]);
-	rlBegin(RL_QUADS);
-		rlColor4ub(color.r, color.g, color.b, color.a);
-		// Back Face
-		rlNormal3f(0.0f, 0.0f, - 1.0f);                  // Normal Pointing Away From Viewer
-		rlTexCoord2f(1.0f, 0.0f); rlVertex3f(x - width/2, y - height/2, z - length/2);  // Bottom Right Of The Texture and Quad
-		rlTexCoord2f(1.0f, 1.0f); rlVertex3f(x - width/2, y + height/2, z - length/2);  // Top Right Of The Texture and Quad
-		rlTexCoord2f(0.0f, 1.0f); rlVertex3f(x + width/2, y + height/2, z - length/2);  // Top Left Of The Texture and Quad
-		rlTexCoord2f(0.0f, 0.0f); rlVertex3f(x + width/2, y - height/2, z - length/2);  // Bottom Left Of The Texture and Quad
-	rlEnd();
+struct ChunkModel {
+    std::vector<Mesh> meshes;
+    BoundingBox bounds;
+    int triangles = 0;
+    occlusion::Graph graph;
+};
 
-	rlSetTexture(T[2]);
-	rlBegin(RL_QUADS);
-		rlColor4ub(color.r, color.g, color.b, color.a);
-		// Top Face
-		rlNormal3f(0.0f, 1.0f, 0.0f);                  // Normal Pointing Up
-		rlTexCoord2f(0.0f, 1.0f); rlVertex3f(x - width/2, y + height/2, z - length/2);  // Top Left Of The Texture and Quad
-		rlTexCoord2f(0.0f, 0.0f); rlVertex3f(x - width/2, y + height/2, z + length/2);  // Bottom Left Of The Texture and Quad
-		rlTexCoord2f(1.0f, 0.0f); rlVertex3f(x + width/2, y + height/2, z + length/2);  // Bottom Right Of The Texture and Quad
-		rlTexCoord2f(1.0f, 1.0f); rlVertex3f(x + width/2, y + height/2, z - length/2);  // Top Right Of The Texture and Quad
-	rlEnd();
+Mesh UploadQuads(const mesher::Quad *quads, int count, const atlas::Atlas &at) {
+    Mesh mesh = {};
+    mesh.vertexCount = count * 4;
+    mesh.triangleCount = count * 2;
+    mesh.vertices = (float *)malloc(mesh.vertexCount * 3 * sizeof(float));
+    mesh.texcoords = (float *)malloc(mesh.vertexCount * 2 * sizeof(float));
+    mesh.texcoords2 = (float *)malloc(mesh.vertexCount * 2 * sizeof(float));
+    mesh.normals = (float *)malloc(mesh.vertexCount * 3 * sizeof(float));
+    mesh.colors = (unsigned char *)malloc(mesh.vertexCount * 4 * sizeof(unsigned char));
+    mesh.indices = (unsigned short *)malloc(mesh.triangleCount * 3 * sizeof(unsigned short));
 
-	rlSetTexture(T[3]);
-	rlBegin(RL_QUADS);
-		rlColor4ub(color.r, color.g, color.b, color.a);
-		// Bottom Face
-		rlNormal3f(0.0f, - 1.0f, 0.0f);                  // Normal Pointing Down
-		rlTexCoord2f(1.0f, 1.0f); rlVertex3f(x - width/2, y - height/2, z - length/2);  // Top Right Of The Texture and Quad
-		rlTexCoord2f(0.0f, 1.0f); rlVertex3f(x + width/2, y - height/2, z - length/2);  // Top Left Of The Texture and Quad
-		rlTexCoord2f(0.0f, 0.0f); rlVertex3f(x + width/2, y - height/2, z + length/2);  // Bottom Left Of The Texture and Quad
-		rlTexCoord2f(1.0f, 0.0f); rlVertex3f(x - width/2, y - height/2, z + length/2);  // Bottom Right Of The Texture and Quad
-	rlEnd();
+    for (int i = 0; i < count; i++) {
+        float normal[3];
+        mesher::vertices(quads[i], mesh.vertices + i * 12, mesh.texcoords + i * 8, normal);
+        // light and corner occlusion are baked in, the shader only multiplies by the vertex colour
+        unsigned char rgb[3];
+        light::colour(quads[i].light, rgb);
+        for (int v = 0; v < 4; v++) {
+            memcpy(mesh.normals + (i * 4 + v) * 3, normal, sizeof(normal));
+            memcpy(mesh.texcoords2 + (i * 4 + v) * 2, at.uv[quads[i].tile], sizeof(at.uv[0]));
+            unsigned char *col = mesh.colors + (i * 4 + v) * 4;
+            float shade = mesher::AO_SHADE[mesher::occlusion(quads[i], v)];
+            for (int k = 0; k < 3; k++) col[k] = (unsigned char)(rgb[k] * shade + 0.5f);
+            col[3] = 255;
+        }
 
-	rlSetTexture(T[4]);
-	rlBegin(RL_QUADS);
-		rlColor4ub(color.r, color.g, color.b, color.a);
-		// Right face
-		rlNormal3f(1.0f, 0.0f, 0.0f);                  // Normal Pointing Right
-		rlTexCoord2f(1.0f, 0.0f); rlVertex3f(x + width/2, y - height/2, z - length/2);  // Bottom Right Of The Texture and Quad
-		rlTexCoord2f(1.0f, 1.0f); rlVertex3f(x + width/2, y + height/2, z - length/2);  // Top Right Of The Texture and Quad
-		rlTexCoord2f(0.0f, 1.0f); rlVertex3f(x + width/2, y + height/2, z + length/2);  // Top Left Of The Texture and Quad
-		rlTexCoord2f(0.0f, 0.0f); rlVertex3f(x + width/2, y - height/2, z + length/2);  // Bottom Left Of The Texture and Quad
-	rlEnd();
+        unsigned short b = i * 4;
+        unsigned short *idx = mesh.indices + i * 6;
+        int d = mesher::flipped(quads[i]) ? 1 : 0;  // first corner of the diagonal the quad is split along
+        idx[0] = b + d; idx[1] = b + d + 1; idx[2] = b + (d + 2) % 4;
+        idx[3] = b + d; idx[4] = b + (d + 2) % 4; idx[5] = b + (d + 3) % 4;
+    }
 
-	rlSetTexture(T[5]);
-	rlBegin(RL_QUADS);
-		rlColor4ub(color.r, color.g, color.b, color.a);
-		// Left Face
-		rlNormal3f( - 1.0f, 0.0f, 0.0f);                  // Normal Pointing Left
-		rlTexCoord2f(0.0f, 0.0f); rlVertex3f(x - width/2, y - height/2, z - length/2);  // Bottom Left Of The Texture and Quad
-		rlTexCoord2f(1.0f, 0.0f); rlVertex3f(x - width/2, y - height/2, z + length/2);  // Bottom Right Of The Texture and Quad
-		rlTexCoord2f(1.0f, 1.0f); rlVertex3f(x - width/2, y + height/2, z + length/2);  // Top Right Of The Texture and Quad
-		rlTexCoord2f(0.0f, 1.0f); rlVertex3f(x - width/2, y + height/2, z - length/2);  // Top Left Of The Texture and Quad
-	rlEnd();
+    UploadMesh(&mesh, false);
+    return mesh;
+}
+
+void UnloadChunkModel(ChunkModel &model) {
+    for (Mesh &m : model.meshes) UnloadMesh(m);
+    model.meshes.clear();
+    model.triangles = 0;
+}
+
+void UploadChunkModel(ChunkModel &model, const mesher::ChunkMesh &cm, const atlas::Atlas &at) {
+    const int MAX_QUADS = 65536 / 4;
+    UnloadChunkModel(model);
+
+    for (size_t start = 0; start < cm.quads.size(); start += MAX_QUADS) {
+        int count = cm.quads.size() - start < MAX_QUADS ? cm.quads.size() - start : MAX_QUADS;
+        model.meshes.push_back(UploadQuads(&cm.quads[start], count, at));
+    }
+    model.triangles = cm.triangle_count();
+    model.graph = cm.graph;
+
+    // lod tiles cover 2^lod chunks along each side
+    float span = world::CHUNK_SIZE << cm.lod;
+    float x = cm.cx * span, z = cm.cz * span;
+    model.bounds = BoundingBox {
+        Vector3 { x, (float)cm.min_y, z },
+        Vector3 { x + span, (float)cm.max_y, z + span }
+    };
+}
 
-	rlSetTexture(0);
+void DrawChunkModel(const ChunkModel &model, const atlas::Atlas &at) {
+    for (const Mesh &m : model.meshes) DrawMesh(m, at.material, MatrixIdentity());
 }
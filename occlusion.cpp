@@ -0,0 +1,190 @@
+// Chunk visibility graph, which faces of every section of a chunk see each other through air, and a
+// breadth-first walk from the camera's section through them to find the chunks that can be seen at all
+// NOTE: no raylib in here; chunks are full-height columns, so the graph works on 8 block tall sections, otherwise
+// the open sky above every chunk would connect all of its faces (and the ground is rarely more than 16 deep)
+#pragma once
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include "world.cpp"
+
+namespace occlusion
+{
+    const int SECTION = 8;  // section height, a section is 16 x 8 x 16 blocks
+    const int SECTIONS = world::CHUNK_HEIGHT / SECTION;
+    const unsigned char ALL = 0x3f;
+
+    // same order as mesher::Face, opposite faces only differ in the lowest bit
+    const int STEP[6][3] = {{0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}};
+    inline int opposite(int f) { return f ^ 1; }
+
+    // the faces reached through air from each face of each section, one bit per face
+    struct Graph {
+        unsigned char reach[SECTIONS][6];
+
+        Graph() { open(); }
+        void open() { memset(reach, ALL, sizeof(reach)); }
+        bool sees(int s, int from, int to) const { return reach[s][from] >> to & 1; }
+    };
+
+    const int CELLS = SECTION * world::CHUNK_AREA;
+
+    // flood fill the pocket of air around cell `start` of a section's blocks, returns the faces it touches
+    inline unsigned char fill(const unsigned char *b, int start, std::vector<unsigned char> &seen) {
+        using namespace world;
+        static thread_local std::vector<unsigned short> stack;
+        unsigned char touched = 0;
+        seen[start] = 1;
+        stack.assign(1, (unsigned short)start);
+        while (!stack.empty()) {
+            int i = stack.back();
+            stack.pop_back();
+            int x = i % CHUNK_SIZE, z = i / CHUNK_SIZE % CHUNK_SIZE, y = i / CHUNK_AREA;
+            if (z == CHUNK_SIZE - 1) touched |= 1 << 0;
+            if (z == 0) touched |= 1 << 1;
+            if (y == SECTION - 1) touched |= 1 << 2;
+            if (y == 0) touched |= 1 << 3;
+            if (x == CHUNK_SIZE - 1) touched |= 1 << 4;
+            if (x == 0) touched |= 1 << 5;
+
+            auto push = [&](int n) {
+                if (b[n] == Air && !seen[n]) {
+                    seen[n] = 1;
+                    stack.push_back((unsigned short)n);
+                }
+            };
+            if (z < CHUNK_SIZE - 1) push(i + CHUNK_SIZE);
+            if (z > 0) push(i - CHUNK_SIZE);
+            if (y < SECTION - 1) push(i + CHUNK_AREA);
+            if (y > 0) push(i - CHUNK_AREA);
+            if (x < CHUNK_SIZE - 1) push(i + 1);
+            if (x > 0) push(i - 1);
+        }
+        return touched;
+    }
+
+    // flood fill the air of every section, each connected pocket links all the faces it touches
+    // NOTE: sections above the tallest column are all air and need no fill, solid ones none either
+    void connect(const world::Chunk &c, Graph &out) {
+        using namespace world;
+        static thread_local std::vector<unsigned char> seen;
+
+        int top = -1;
+        for (short h : c.height) top = h > top ? h : top;
+        memset(out.reach, 0, sizeof(out.reach));
+
+        for (int s = 0; s < SECTIONS; s++) {
+            if (s * SECTION > top) {
+                memset(out.reach[s], ALL, 6);
+                continue;
+            }
+            // y-major, so a section is one contiguous run of blocks
+            const unsigned char *b = c.blocks + index(0, s * SECTION, 0);
+            int air = 0;
+            for (int i = 0; i < CELLS; i++) air += b[i] == Air;
+            if (air == 0) continue;
+            if (air == CELLS) {
+                memset(out.reach[s], ALL, 6);
+                continue;
+            }
+
+            seen.assign(CELLS, 0);
+            for (int start = 0; start < CELLS; start++) {
+                if (b[start] != Air || seen[start]) continue;
+                unsigned char touched = fill(b, start, seen);
+                for (int f = 0; f < 6; f++)
+                    if (touched >> f & 1) out.reach[s][f] |= touched;
+            }
+        }
+    }
+
+    // faces of its section the pocket of air around block (x, y, z) touches, where the camera's walk may start from
+    // NOTE: all of them when the block is solid (the camera is in a wall) or its chunk is not loaded
+    inline unsigned char pocket(const world::World &w, int x, int y, int z) {
+        using namespace world;
+        static thread_local std::vector<unsigned char> seen;
+        const Chunk *c = w.chunk(chunk_of(x), chunk_of(z));
+        if (!c || y < 0 || y >= CHUNK_HEIGHT) return ALL;
+        int s = y / SECTION, i = index(local_of(x), y % SECTION, local_of(z));
+        const unsigned char *b = c->blocks + index(0, s * SECTION, 0);
+        if (b[i] != Air) return ALL;
+        seen.assign(CELLS, 0);
+        return fill(b, i, seen);
+    }
+
+    // breadth-first over the sections within `radius` chunks of the camera. A section is entered once, through
+    // a face its neighbour sees out of from where it was entered, and never in a direction opposite to one
+    // already taken, so the walk only moves away from the camera
+    // NOTE: chunks without a graph yet count as all air, so nothing behind an unmeshed chunk is lost
+    struct Walk {
+        std::function<const Graph *(int, int)> graph;   // cx, cz, null when not meshed
+        std::function<bool(int, int, int)> inside;      // cx, section, cz is in the view, null for everything
+
+        int cx = 0, cz = 0, radius = 0;
+        int visited = 0;                 // sections entered by the last run()
+        std::vector<unsigned char> seen; // per column within the radius, any of its sections entered
+
+        // `start` is the faces the camera's section is left through, see pocket(); false when the camera is
+        // outside the world's height, nothing is culled then
+        bool run(float x, float y, float z, int r, unsigned char start = ALL) {
+            using namespace world;
+            cx = chunk_of((int)floorf(x));
+            cz = chunk_of((int)floorf(z));
+            radius = r;
+            visited = 0;
+            int side = 2 * r + 1;
+            seen.assign(side * side, 0);
+            if (y < 0 || y >= CHUNK_HEIGHT) {
+                radius = -1;
+                return false;
+            }
+
+            struct Node {
+                int x, s, z;  // column relative to the camera's, section
+                signed char from;  // face it was entered through, -1 for the camera's
+                unsigned char went;  // directions taken to get here
+            };
+            static thread_local std::vector<unsigned char> entered;
+            static thread_local std::vector<Node> queue;
+            entered.assign(side * side * SECTIONS, 0);
+            queue.clear();
+
+            auto at = [&](int x, int s, int z) { return ((z + r) * side + x + r) * SECTIONS + s; };
+            queue.push_back(Node {0, (int)y / SECTION, 0, -1, 0});
+            entered[at(0, (int)y / SECTION, 0)] = 1;
+            for (size_t q = 0; q < queue.size(); q++) {
+                Node n = queue[q];
+                seen[(n.z + r) * side + n.x + r] = 1;
+                visited++;
+                const Graph *g = graph ? graph(cx + n.x, cz + n.z) : nullptr;
+                for (int f = 0; f < 6; f++) {
+                    if (n.from < 0 && !(start >> f & 1)) continue;
+                    if (n.went >> opposite(f) & 1) continue;
+                    if (n.from >= 0 && g && !g->sees(n.s, n.from, f)) continue;
+                    int nx = n.x + STEP[f][0], ns = n.s + STEP[f][1], nz = n.z + STEP[f][2];
+                    if (ns < 0 || ns >= SECTIONS || nx < -r || nx > r || nz < -r || nz > r) continue;
+                    if (entered[at(nx, ns, nz)]) continue;
+                    if (inside && !inside(cx + nx, ns, cz + nz)) continue;
+                    entered[at(nx, ns, nz)] = 1;
+                    queue.push_back(Node {nx, ns, nz, (signed char)opposite(f), (unsigned char)(n.went | 1 << f)});
+                }
+            }
+            return true;
+        }
+
+        // chunk (x, z) can be seen, anything outside the radius or with no run is
+        bool reached(int x, int z) const {
+            x -= cx;
+            z -= cz;
+            if (radius < 0 || x < -radius || x > radius || z < -radius || z > radius) return true;
+            return seen[(z + radius) * (2 * radius + 1) + x + radius] != 0;
+        }
+
+        int reached_count() const {
+            int n = 0;
+            for (unsigned char s : seen) n += s;
+            return n;
+        }
+    };
+}
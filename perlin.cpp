@@ -1,5 +1,10 @@
+#pragma once
 #include <cstdlib>
 #include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+	#define PERLIN_X86 1
+#endif
 
 namespace perlin
 {
@@ -56,4 +61,283 @@ namespace perlin
 
 		return fin / div;
 	}
-}
\ No newline at end of file
+
+	//----------------------------------------------------------------------------------
+	// Seeded gradient noise
+	//----------------------------------------------------------------------------------
+	// 2D improved Perlin noise over a permutation shuffled from the seed, summed as fBm octaves
+	const float GRAD_X[8] = {1, -1, 1, -1, 1, -1, 0, 0};
+	const float GRAD_Y[8] = {1, 1, -1, -1, 0, 0, 1, -1};
+	// the 12 cube edge directions of 3D improved noise, 4 of them twice so a hash & 15 picks one
+	const float GRAD3_X[16] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 1, 0, -1, 0};
+	const float GRAD3_Y[16] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1};
+	const float GRAD3_Z[16] = {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1, 0, 1, 0, -1};
+
+	inline float fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+
+	struct Noise;
+	typedef void (*RowKernel)(const Noise &n, float x, float y, int count, float *out);
+	const RowKernel &row_kernel();
+
+	struct Noise
+	{
+		int seed;
+		int octaves;
+		float frequency, lacunarity, gain;
+		int perm[512];  // doubled so perm[perm[x] + y] never wraps
+
+		Noise(int seed = SEED, int octaves = 1, float frequency = 0.1f, float lacunarity = 2.0f, float gain = 0.5f)
+			: seed(seed), octaves(octaves), frequency(frequency), lacunarity(lacunarity), gain(gain)
+		{
+			// fisher-yates with splitmix64, the same table on every platform
+			unsigned long long state = (unsigned long long)(unsigned int)seed;
+			for (int i = 0; i < 256; i++)
+				perm[i] = i;
+			for (int i = 255; i > 0; i--)
+			{
+				unsigned long long z = (state += 0x9E3779B97F4A7C15ull);
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				z ^= z >> 31;
+				int j = z % (i + 1);
+				int t = perm[i];
+				perm[i] = perm[j];
+				perm[j] = t;
+			}
+			for (int i = 0; i < 256; i++)
+				perm[256 + i] = perm[i];
+		}
+
+		// single octave, roughly in [-1, 1]
+		float gradient2d(float x, float y) const
+		{
+			float xfl = floorf(x), yfl = floorf(y);
+			float xf = x - xfl, yf = y - yfl;
+			int X = (int)xfl & 255, Y = (int)yfl & 255;
+			int a = perm[X], b = perm[X + 1];
+			int h00 = perm[a + Y] & 7, h01 = perm[a + Y + 1] & 7, h10 = perm[b + Y] & 7, h11 = perm[b + Y + 1] & 7;
+			float g00 = GRAD_X[h00] * xf + GRAD_Y[h00] * yf;
+			float g10 = GRAD_X[h10] * (xf - 1) + GRAD_Y[h10] * yf;
+			float g01 = GRAD_X[h01] * xf + GRAD_Y[h01] * (yf - 1);
+			float g11 = GRAD_X[h11] * (xf - 1) + GRAD_Y[h11] * (yf - 1);
+			float u = fade(xf), v = fade(yf);
+			float low = lin_inter(g00, g10, u), high = lin_inter(g01, g11, u);
+			return lin_inter(low, high, v);
+		}
+
+		// fBm of all octaves, mapped to [0, 1]
+		float fbm2d(float x, float y) const
+		{
+			float fx = x * frequency, fy = y * frequency, amp = 1, sum = 0, norm = 0;
+			for (int o = 0; o < octaves; o++)
+			{
+				sum += gradient2d(fx, fy) * amp;
+				norm += amp;
+				amp *= gain;
+				fx *= lacunarity;
+				fy *= lacunarity;
+			}
+			float r = sum / norm * 0.5f + 0.5f;
+			return r < 0 ? 0 : (r > 1 ? 1 : r);
+		}
+
+		// single octave of 3D noise, roughly in [-1, 1]
+		float gradient3d(float x, float y, float z) const
+		{
+			float xfl = floorf(x), yfl = floorf(y), zfl = floorf(z);
+			float xf = x - xfl, yf = y - yfl, zf = z - zfl;
+			int X = (int)xfl & 255, Y = (int)yfl & 255, Z = (int)zfl & 255;
+			int a = perm[X] + Y, b = perm[X + 1] + Y;
+			int aa = perm[a] + Z, ab = perm[a + 1] + Z, ba = perm[b] + Z, bb = perm[b + 1] + Z;
+			auto g = [](int h, float dx, float dy, float dz) { h &= 15; return GRAD3_X[h] * dx + GRAD3_Y[h] * dy + GRAD3_Z[h] * dz; };
+			float u = fade(xf), v = fade(yf), w = fade(zf);
+			float x00 = lin_inter(g(perm[aa], xf, yf, zf), g(perm[ba], xf - 1, yf, zf), u);
+			float x10 = lin_inter(g(perm[ab], xf, yf - 1, zf), g(perm[bb], xf - 1, yf - 1, zf), u);
+			float x01 = lin_inter(g(perm[aa + 1], xf, yf, zf - 1), g(perm[ba + 1], xf - 1, yf, zf - 1), u);
+			float x11 = lin_inter(g(perm[ab + 1], xf, yf - 1, zf - 1), g(perm[bb + 1], xf - 1, yf - 1, zf - 1), u);
+			return lin_inter(lin_inter(x00, x10, v), lin_inter(x01, x11, v), w);
+		}
+
+		// fBm of all octaves of 3D noise, mapped to [0, 1]
+		float fbm3d(float x, float y, float z) const
+		{
+			float fx = x * frequency, fy = y * frequency, fz = z * frequency, amp = 1, sum = 0, norm = 0;
+			for (int o = 0; o < octaves; o++)
+			{
+				sum += gradient3d(fx, fy, fz) * amp;
+				norm += amp;
+				amp *= gain;
+				fx *= lacunarity;
+				fy *= lacunarity;
+				fz *= lacunarity;
+			}
+			float r = sum / norm * 0.5f + 0.5f;
+			return r < 0 ? 0 : (r > 1 ? 1 : r);
+		}
+
+		// out[i] = fbm2d(x + i, y) for i < count, on the best kernel for this cpu
+		void fbm2d_row(float x, float y, int count, float *out) const { row_kernel()(*this, x, y, count, out); }
+
+		// w x h block, out[j * w + i] = fbm2d(x + i, y + j)
+		void fbm2d_grid(float x, float y, int w, int h, float *out) const
+		{
+			for (int j = 0; j < h; j++)
+				fbm2d_row(x, y + j, w, out + j * w);
+		}
+	};
+
+	//----------------------------------------------------------------------------------
+	// Batch evaluation
+	//----------------------------------------------------------------------------------
+	// NOTE: every kernel does the scalar path's float operations in the same order (no fma),
+	// so the vector kernels match Noise::fbm2d exactly; the documented tolerance is 0 ulp
+	void fbm2d_row_scalar(const Noise &n, float x, float y, int count, float *out)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = n.fbm2d(x + i, y);
+	}
+
+#ifdef PERLIN_X86
+	__attribute__((target("sse2"))) void fbm2d_row_sse2(const Noise &n, float x, float y, int count, float *out)
+	{
+		int c = count & ~3;
+		const __m128 one = _mm_set1_ps(1), six = _mm_set1_ps(6), fifteen = _mm_set1_ps(15), ten = _mm_set1_ps(10);
+		for (int i = 0; i < c; i += 4)
+		{
+			__m128 fx = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(x), _mm_setr_ps(i, i + 1, i + 2, i + 3)), _mm_set1_ps(n.frequency));
+			float fy = y * n.frequency, amp = 1, norm = 0;
+			__m128 sum = _mm_setzero_ps();
+
+			for (int o = 0; o < n.octaves; o++)
+			{
+				// the row shares y, only the x side differs per lane
+				float yfl = floorf(fy), yf = fy - yfl;
+				int Y = (int)yfl & 255;
+
+				// floor without sse4.1: truncate, then step down where that rounded up
+				__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+				__m128 xfl = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, fx), one));
+				__m128 xf = _mm_sub_ps(fx, xfl);
+				alignas(16) int X[4];
+				_mm_store_si128((__m128i *)X, _mm_cvttps_epi32(xfl));
+
+				alignas(16) float gx00[4], gy00[4], gx10[4], gy10[4], gx01[4], gy01[4], gx11[4], gy11[4];
+				for (int l = 0; l < 4; l++)
+				{
+					int a = n.perm[X[l] & 255], b = n.perm[(X[l] & 255) + 1];
+					int h00 = n.perm[a + Y] & 7, h01 = n.perm[a + Y + 1] & 7, h10 = n.perm[b + Y] & 7, h11 = n.perm[b + Y + 1] & 7;
+					gx00[l] = GRAD_X[h00]; gy00[l] = GRAD_Y[h00];
+					gx10[l] = GRAD_X[h10]; gy10[l] = GRAD_Y[h10];
+					gx01[l] = GRAD_X[h01]; gy01[l] = GRAD_Y[h01];
+					gx11[l] = GRAD_X[h11]; gy11[l] = GRAD_Y[h11];
+				}
+
+				__m128 vyf = _mm_set1_ps(yf), vyf1 = _mm_set1_ps(yf - 1), xf1 = _mm_sub_ps(xf, one);
+				__m128 g00 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx00), xf), _mm_mul_ps(_mm_load_ps(gy00), vyf));
+				__m128 g10 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx10), xf1), _mm_mul_ps(_mm_load_ps(gy10), vyf));
+				__m128 g01 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx01), xf), _mm_mul_ps(_mm_load_ps(gy01), vyf1));
+				__m128 g11 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx11), xf1), _mm_mul_ps(_mm_load_ps(gy11), vyf1));
+
+				__m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(xf, xf), xf), _mm_add_ps(_mm_mul_ps(xf, _mm_sub_ps(_mm_mul_ps(xf, six), fifteen)), ten));
+				__m128 v = _mm_set1_ps(fade(yf));
+				__m128 low = _mm_add_ps(g00, _mm_mul_ps(u, _mm_sub_ps(g10, g00)));
+				__m128 high = _mm_add_ps(g01, _mm_mul_ps(u, _mm_sub_ps(g11, g01)));
+				__m128 g = _mm_add_ps(low, _mm_mul_ps(v, _mm_sub_ps(high, low)));
+
+				sum = _mm_add_ps(sum, _mm_mul_ps(g, _mm_set1_ps(amp)));
+				norm += amp;
+				amp *= n.gain;
+				fx = _mm_mul_ps(fx, _mm_set1_ps(n.lacunarity));
+				fy *= n.lacunarity;
+			}
+			__m128 r = _mm_add_ps(_mm_mul_ps(_mm_div_ps(sum, _mm_set1_ps(norm)), _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f));
+			_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(r, _mm_setzero_ps()), one));
+		}
+		fbm2d_row_scalar(n, x + c, y, count - c, out + c);
+	}
+
+	__attribute__((target("avx2"))) void fbm2d_row_avx2(const Noise &n, float x, float y, int count, float *out)
+	{
+		int c = count & ~7;
+		const __m256 one = _mm256_set1_ps(1), six = _mm256_set1_ps(6), fifteen = _mm256_set1_ps(15), ten = _mm256_set1_ps(10);
+		const __m256i mask = _mm256_set1_epi32(255), seven = _mm256_set1_epi32(7), ione = _mm256_set1_epi32(1);
+		for (int i = 0; i < c; i += 8)
+		{
+			__m256 fx = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(x), _mm256_setr_ps(i, i + 1, i + 2, i + 3, i + 4, i + 5, i + 6, i + 7)), _mm256_set1_ps(n.frequency));
+			float fy = y * n.frequency, amp = 1, norm = 0;
+			__m256 sum = _mm256_setzero_ps();
+
+			for (int o = 0; o < n.octaves; o++)
+			{
+				float yfl = floorf(fy), yf = fy - yfl;
+				__m256i Y = _mm256_set1_epi32((int)yfl & 255), Y1 = _mm256_add_epi32(Y, ione);
+
+				__m256 xfl = _mm256_floor_ps(fx);
+				__m256 xf = _mm256_sub_ps(fx, xfl);
+				__m256i X = _mm256_and_si256(_mm256_cvttps_epi32(xfl), mask);
+				__m256i a = _mm256_i32gather_epi32(n.perm, X, 4);
+				__m256i b = _mm256_i32gather_epi32(n.perm, _mm256_add_epi32(X, ione), 4);
+				__m256i h00 = _mm256_and_si256(_mm256_i32gather_epi32(n.perm, _mm256_add_epi32(a, Y), 4), seven);
+				__m256i h01 = _mm256_and_si256(_mm256_i32gather_epi32(n.perm, _mm256_add_epi32(a, Y1), 4), seven);
+				__m256i h10 = _mm256_and_si256(_mm256_i32gather_epi32(n.perm, _mm256_add_epi32(b, Y), 4), seven);
+				__m256i h11 = _mm256_and_si256(_mm256_i32gather_epi32(n.perm, _mm256_add_epi32(b, Y1), 4), seven);
+
+				__m256 vyf = _mm256_set1_ps(yf), vyf1 = _mm256_set1_ps(yf - 1), xf1 = _mm256_sub_ps(xf, one);
+				__m256 g00 = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(GRAD_X, h00, 4), xf), _mm256_mul_ps(_mm256_i32gather_ps(GRAD_Y, h00, 4), vyf));
+				__m256 g10 = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(GRAD_X, h10, 4), xf1), _mm256_mul_ps(_mm256_i32gather_ps(GRAD_Y, h10, 4), vyf));
+				__m256 g01 = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(GRAD_X, h01, 4), xf), _mm256_mul_ps(_mm256_i32gather_ps(GRAD_Y, h01, 4), vyf1));
+				__m256 g11 = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(GRAD_X, h11, 4), xf1), _mm256_mul_ps(_mm256_i32gather_ps(GRAD_Y, h11, 4), vyf1));
+
+				__m256 u = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(xf, xf), xf), _mm256_add_ps(_mm256_mul_ps(xf, _mm256_sub_ps(_mm256_mul_ps(xf, six), fifteen)), ten));
+				__m256 v = _mm256_set1_ps(fade(yf));
+				__m256 low = _mm256_add_ps(g00, _mm256_mul_ps(u, _mm256_sub_ps(g10, g00)));
+				__m256 high = _mm256_add_ps(g01, _mm256_mul_ps(u, _mm256_sub_ps(g11, g01)));
+				__m256 g = _mm256_add_ps(low, _mm256_mul_ps(v, _mm256_sub_ps(high, low)));
+
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(g, _mm256_set1_ps(amp)));
+				norm += amp;
+				amp *= n.gain;
+				fx = _mm256_mul_ps(fx, _mm256_set1_ps(n.lacunarity));
+				fy *= n.lacunarity;
+			}
+			__m256 r = _mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(sum, _mm256_set1_ps(norm)), _mm256_set1_ps(0.5f)), _mm256_set1_ps(0.5f));
+			_mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(r, _mm256_setzero_ps()), one));
+		}
+		fbm2d_row_sse2(n, x + c, y, count - c, out + c);
+	}
+#endif
+
+	struct Kernel
+	{
+		const char *name;
+		RowKernel row;
+		bool supported;
+	};
+
+	// every kernel this build has, best first
+	const Kernel *kernels(int *count)
+	{
+		static const Kernel list[] = {
+#ifdef PERLIN_X86
+			{"avx2", fbm2d_row_avx2, (bool)__builtin_cpu_supports("avx2")},
+			{"sse2", fbm2d_row_sse2, (bool)__builtin_cpu_supports("sse2")},
+#endif
+			{"scalar", fbm2d_row_scalar, true}};
+		*count = sizeof(list) / sizeof(list[0]);
+		return list;
+	}
+
+	// best kernel the cpu supports, picked once at runtime
+	const Kernel &kernel()
+	{
+		static const Kernel *best = []() {
+			int n;
+			const Kernel *k = kernels(&n);
+			while (!k->supported) k++;
+			return k;
+		}();
+		return *best;
+	}
+
+	const RowKernel &row_kernel() { return kernel().row; }
+}
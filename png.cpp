@@ -0,0 +1,333 @@
+// Minimal PNG reading and writing, enough for the block textures and rendered frames
+// NOTE: no raylib in here; reads 8-bit grey, rgb, grey+alpha and rgba without interlacing, writes rgba
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace png
+{
+    struct Image {
+        int width = 0, height = 0;
+        std::vector<unsigned char> rgba;  // 4 bytes per pixel, rows top to bottom
+
+        void resize(int w, int h) {
+            width = w;
+            height = h;
+            rgba.assign((size_t)w * h * 4, 0);
+        }
+        unsigned char *at(int x, int y) { return &rgba[((size_t)y * width + x) * 4]; }
+        const unsigned char *at(int x, int y) const { return &rgba[((size_t)y * width + x) * 4]; }
+    };
+
+    const unsigned char SIGNATURE[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+
+    inline unsigned crc(const unsigned char *p, size_t n, unsigned c = 0) {
+        static const auto table = []() {
+            std::array<unsigned, 256> t;
+            for (unsigned i = 0; i < 256; i++) {
+                unsigned v = i;
+                for (int k = 0; k < 8; k++) v = v & 1 ? 0xedb88320u ^ (v >> 1) : v >> 1;
+                t[i] = v;
+            }
+            return t;
+        }();
+        c = ~c;
+        for (size_t i = 0; i < n; i++) c = table[(c ^ p[i]) & 0xff] ^ (c >> 8);
+        return ~c;
+    }
+
+    inline unsigned adler(const unsigned char *p, size_t n) {
+        unsigned a = 1, b = 0;
+        for (size_t i = 0; i < n; i++) {
+            a = (a + p[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    inline unsigned be32(const unsigned char *p) { return (unsigned)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+
+    // zlib stream inflater, canonical huffman decoding as in RFC 1951
+    struct Inflate {
+        const unsigned char *in;
+        size_t size, pos = 0;
+        unsigned bits = 0;
+        int count = 0;
+        std::vector<unsigned char> &out;
+
+        struct Huffman {
+            short counts[16];
+            short symbols[288];
+        };
+
+        Inflate(const unsigned char *in, size_t size, std::vector<unsigned char> &out) : in(in), size(size), out(out) {}
+
+        // -1 when the input ran out
+        int bit(int n) {
+            while (count < n) {
+                if (pos >= size) return -1;
+                bits |= (unsigned)in[pos++] << count;
+                count += 8;
+            }
+            int v = bits & ((1u << n) - 1);
+            bits >>= n;
+            count -= n;
+            return v;
+        }
+
+        static void build(Huffman &h, const unsigned char *lengths, int n) {
+            short offsets[16];
+            memset(h.counts, 0, sizeof(h.counts));
+            for (int i = 0; i < n; i++) h.counts[lengths[i]]++;
+            h.counts[0] = 0;
+            offsets[1] = 0;
+            for (int l = 1; l < 15; l++) offsets[l + 1] = offsets[l] + h.counts[l];
+            for (int i = 0; i < n; i++)
+                if (lengths[i]) h.symbols[offsets[lengths[i]]++] = i;
+        }
+
+        int decode(const Huffman &h) {
+            int code = 0, first = 0, index = 0;
+            for (int l = 1; l < 16; l++) {
+                int b = bit(1);
+                if (b < 0) return -1;
+                code |= b;
+                int n = h.counts[l];
+                if (code - n < first) return h.symbols[index + (code - first)];
+                index += n;
+                first = (first + n) << 1;
+                code <<= 1;
+            }
+            return -1;
+        }
+
+        bool codes(const Huffman &lit, const Huffman &dist) {
+            static const short LEN_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            static const short LEN_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+            static const short DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+            static const short DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+            for (;;) {
+                int s = decode(lit);
+                if (s < 0) return false;
+                if (s < 256) {
+                    out.push_back(s);
+                } else if (s == 256) {
+                    return true;
+                } else {
+                    s -= 257;
+                    if (s >= 29) return false;
+                    int e = bit(LEN_EXTRA[s]);
+                    int d = decode(dist);
+                    if (e < 0 || d < 0 || d >= 30) return false;
+                    int len = LEN_BASE[s] + e;
+                    int de = bit(DIST_EXTRA[d]);
+                    if (de < 0) return false;
+                    size_t back = DIST_BASE[d] + de;
+                    if (back > out.size()) return false;
+                    for (int i = 0; i < len; i++) out.push_back(out[out.size() - back]);
+                }
+            }
+        }
+
+        bool stored() {
+            bits = 0;
+            count = 0;
+            if (pos + 4 > size) return false;
+            unsigned len = in[pos] | in[pos + 1] << 8;
+            pos += 4;
+            if (pos + len > size) return false;
+            out.insert(out.end(), in + pos, in + pos + len);
+            pos += len;
+            return true;
+        }
+
+        bool fixed() {
+            static const auto tables = []() {
+                std::array<Huffman, 2> h;  // literal/length, distance
+                unsigned char l[288];
+                for (int i = 0; i < 288; i++) l[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+                build(h[0], l, 288);
+                for (int i = 0; i < 30; i++) l[i] = 5;
+                build(h[1], l, 30);
+                return h;
+            }();
+            return codes(tables[0], tables[1]);
+        }
+
+        bool dynamic() {
+            static const unsigned char ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+            int nlen = bit(5), ndist = bit(5), ncode = bit(4);
+            if (nlen < 0 || ndist < 0 || ncode < 0) return false;
+            nlen += 257;
+            ndist += 1;
+            ncode += 4;
+            if (nlen > 286 || ndist > 30) return false;
+
+            unsigned char lengths[320] = {0};
+            for (int i = 0; i < ncode; i++) {
+                int v = bit(3);
+                if (v < 0) return false;
+                lengths[ORDER[i]] = v;
+            }
+            Huffman lencode, lit, dist;
+            build(lencode, lengths, 19);
+
+            int i = 0;
+            while (i < nlen + ndist) {
+                int s = decode(lencode);
+                if (s < 0) return false;
+                if (s < 16) {
+                    lengths[i++] = s;
+                    continue;
+                }
+                // 16 repeats the previous length, 17 and 18 repeat zero
+                int e = bit(s == 16 ? 2 : s == 17 ? 3 : 7);
+                if (e < 0 || (s == 16 && i == 0)) return false;
+                int value = s == 16 ? lengths[i - 1] : 0;
+                int repeat = (s == 18 ? 11 : 3) + e;
+                if (i + repeat > nlen + ndist) return false;
+                while (repeat--) lengths[i++] = value;
+            }
+            build(lit, lengths, nlen);
+            build(dist, lengths + nlen, ndist);
+            return codes(lit, dist);
+        }
+
+        bool run() {
+            if (size < 2 || (in[0] & 0x0f) != 8 || (in[0] << 8 | in[1]) % 31) return false;
+            pos = 2;
+            for (;;) {
+                int last = bit(1), type = bit(2);
+                if (last < 0 || type < 0) return false;
+                bool ok = type == 0 ? stored() : type == 1 ? fixed() : type == 2 ? dynamic() : false;
+                if (!ok) return false;
+                if (last) return true;
+            }
+        }
+    };
+
+    inline int paeth(int a, int b, int c) {
+        int p = a + b - c, pa = p > a ? p - a : a - p, pb = p > b ? p - b : b - p, pc = p > c ? p - c : c - p;
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    }
+
+    bool load(const char *path, Image &img) {
+        FILE *f = fopen(path, "rb");
+        if (!f) return false;
+        std::vector<unsigned char> file;
+        unsigned char buf[4096];
+        for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) file.insert(file.end(), buf, buf + n);
+        fclose(f);
+        if (file.size() < 8 || memcmp(file.data(), SIGNATURE, 8)) return false;
+
+        int width = 0, height = 0, depth = 0, type = 0, interlace = 0;
+        std::vector<unsigned char> idat;
+        for (size_t p = 8; p + 12 <= file.size();) {
+            unsigned len = be32(&file[p]);
+            if (p + 12 + len > file.size()) return false;
+            const unsigned char *tag = &file[p + 4], *data = &file[p + 8];
+            if (!memcmp(tag, "IHDR", 4) && len >= 13) {
+                width = be32(data);
+                height = be32(data + 4);
+                depth = data[8];
+                type = data[9];
+                interlace = data[12];
+            } else if (!memcmp(tag, "IDAT", 4)) {
+                idat.insert(idat.end(), data, data + len);
+            } else if (!memcmp(tag, "IEND", 4)) {
+                break;
+            }
+            p += 12 + len;
+        }
+        const int CHANNELS[7] = {1, 0, 3, 0, 2, 0, 4};
+        if (width <= 0 || height <= 0 || depth != 8 || type > 6 || !CHANNELS[type] || interlace) return false;
+
+        std::vector<unsigned char> raw;
+        if (!Inflate(idat.data(), idat.size(), raw).run()) return false;
+        int channels = CHANNELS[type];
+        size_t stride = (size_t)width * channels;
+        if (raw.size() < (stride + 1) * height) return false;
+
+        // undo the per-row filters in place
+        for (int y = 0; y < height; y++) {
+            unsigned char filter = raw[y * (stride + 1)];
+            unsigned char *row = &raw[y * (stride + 1) + 1];
+            const unsigned char *up = y ? row - (stride + 1) : nullptr;
+            for (size_t i = 0; i < stride; i++) {
+                int a = i >= (size_t)channels ? row[i - channels] : 0, b = up ? up[i] : 0;
+                int c = up && i >= (size_t)channels ? up[i - channels] : 0;
+                switch (filter) {
+                    case 1: row[i] += a; break;
+                    case 2: row[i] += b; break;
+                    case 3: row[i] += (a + b) / 2; break;
+                    case 4: row[i] += paeth(a, b, c); break;
+                    default: break;
+                }
+            }
+        }
+
+        img.resize(width, height);
+        for (int y = 0; y < height; y++) {
+            const unsigned char *row = &raw[y * (stride + 1) + 1];
+            for (int x = 0; x < width; x++) {
+                const unsigned char *s = row + x * channels;
+                unsigned char *d = img.at(x, y);
+                bool grey = channels < 3;
+                d[0] = s[0];
+                d[1] = grey ? s[0] : s[1];
+                d[2] = grey ? s[0] : s[2];
+                d[3] = channels == 2 ? s[1] : channels == 4 ? s[3] : 255;
+            }
+        }
+        return true;
+    }
+
+    // rows unfiltered in stored (uncompressed) deflate blocks, cheap to write and exact for golden images
+    bool save(const char *path, const Image &img) {
+        size_t stride = (size_t)img.width * 4;
+        std::vector<unsigned char> raw;
+        raw.reserve((stride + 1) * img.height);
+        for (int y = 0; y < img.height; y++) {
+            raw.push_back(0);
+            raw.insert(raw.end(), img.at(0, y), img.at(0, y) + stride);
+        }
+
+        std::vector<unsigned char> z = {0x78, 0x01};
+        for (size_t p = 0; p < raw.size() || p == 0;) {
+            size_t n = std::min<size_t>(raw.size() - p, 65535);
+            bool last = p + n == raw.size();
+            unsigned char head[5] = {(unsigned char)last, (unsigned char)n, (unsigned char)(n >> 8), (unsigned char)~n, (unsigned char)(~n >> 8)};
+            z.insert(z.end(), head, head + 5);
+            z.insert(z.end(), raw.begin() + p, raw.begin() + p + n);
+            p += n;
+            if (last) break;
+        }
+        unsigned a = adler(raw.data(), raw.size());
+        for (int s = 24; s >= 0; s -= 8) z.push_back(a >> s);
+
+        FILE *f = fopen(path, "wb");
+        if (!f) return false;
+        auto chunk = [f](const char *tag, const unsigned char *data, size_t len) {
+            unsigned char b[4] = {(unsigned char)(len >> 24), (unsigned char)(len >> 16), (unsigned char)(len >> 8), (unsigned char)len};
+            fwrite(b, 1, 4, f);
+            fwrite(tag, 1, 4, f);
+            if (len) fwrite(data, 1, len, f);
+            unsigned c = crc(data, len, crc((const unsigned char *)tag, 4));
+            unsigned char t[4] = {(unsigned char)(c >> 24), (unsigned char)(c >> 16), (unsigned char)(c >> 8), (unsigned char)c};
+            fwrite(t, 1, 4, f);
+        };
+        unsigned char ihdr[13] = {
+            (unsigned char)(img.width >> 24), (unsigned char)(img.width >> 16), (unsigned char)(img.width >> 8), (unsigned char)img.width,
+            (unsigned char)(img.height >> 24), (unsigned char)(img.height >> 16), (unsigned char)(img.height >> 8), (unsigned char)img.height,
+            8, 6, 0, 0, 0
+        };
+        fwrite(SIGNATURE, 1, 8, f);
+        chunk("IHDR", ihdr, 13);
+        chunk("IDAT", z.data(), z.size());
+        chunk("IEND", nullptr, 0);
+        return fclose(f) == 0;
+    }
+}
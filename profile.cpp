@@ -0,0 +1,233 @@
+// Scoped frame profiler, every thread records its timed scopes into its own ring buffer
+// NOTE: build with -DPROFILE_ENABLED=0 and PROFILE_SCOPE compiles to nothing, the rest to empty stubs
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED 1
+#endif
+
+namespace profile
+{
+    const int RING = 1 << 15;  // scopes kept per thread
+    const int HISTORY = 600;   // frames kept for the overlay and trace dumps
+
+    // rolling numbers of one stage (all scopes with the same name) on the frame thread and the threads that
+    // follow() it, in ms per frame
+    struct Stat {
+        const char *name;
+        float avg, p99, last;
+    };
+}
+
+#if PROFILE_ENABLED
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// time the rest of the enclosing block, name must be a string literal
+#define PROFILE_SCOPE(name) profile::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+
+namespace profile
+{
+    struct Event {
+        const char *name;
+        long long start, end;  // ns since the profiler started
+    };
+
+    // only its own thread writes, readers copy it and drop whatever got overwritten meanwhile
+    struct Ring {
+        int tid;
+        const char *thread = "thread";
+        std::atomic<unsigned long long> head{0};  // events ever recorded
+        Event events[RING];
+    };
+
+    std::mutex registry;
+    std::vector<std::unique_ptr<Ring>> rings;  // kept for the whole run, a dump still sees threads that exited
+    std::vector<Ring *> followed;              // also folded into the overlay by frame()
+
+    inline long long now() {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    inline Ring &ring() {
+        static thread_local Ring *r = nullptr;
+        if (!r) {
+            std::lock_guard<std::mutex> guard(registry);
+            rings.emplace_back(new Ring());
+            r = rings.back().get();
+            r->tid = rings.size() - 1;
+        }
+        return *r;
+    }
+
+    inline void name_thread(const char *name) { ring().thread = name; }
+
+    // count this thread's scopes into the frame thread's overlay as well, by the frame they ended in
+    inline void follow() {
+        Ring &r = ring();
+        std::lock_guard<std::mutex> guard(registry);
+        followed.push_back(&r);
+    }
+
+    inline void record(const char *name, long long start, long long end) {
+        Ring &r = ring();
+        unsigned long long h = r.head.load(std::memory_order_relaxed);
+        r.events[h % RING] = Event { name, start, end };
+        r.head.store(h + 1, std::memory_order_release);
+    }
+
+    struct Scope {
+        const char *name;
+        long long start;
+        Scope(const char *name) : name(name), start(now()) {}
+        ~Scope() { record(name, start, now()); }
+    };
+
+    // per frame totals of every stage of the thread calling frame() and the followed ones
+    struct Stage {
+        const char *name;
+        float ms[HISTORY];
+    };
+
+    struct History {
+        unsigned long long frames = 0;  // frame() calls so far
+        std::vector<std::pair<const Ring *, unsigned long long>> seen;  // ring heads at the last frame()
+        long long start[HISTORY];       // of every frame
+        float frame_ms[HISTORY];
+        std::vector<Stage> stages;
+
+        Stage &stage(const char *name) {
+            for (Stage &s : stages)
+                if (s.name == name) return s;
+            stages.push_back(Stage { name, {} });
+            return stages.back();
+        }
+    };
+    History history;
+
+    // end the current frame and start the next one, call it once per frame from the frame thread
+    // NOTE: a followed thread's events are read while it keeps recording, like copy() those it lapped are dropped
+    void frame() {
+        long long t = now();
+        std::vector<const Ring *> read = {&ring()};
+        {
+            std::lock_guard<std::mutex> guard(registry);
+            for (const Ring *r : followed)
+                if (r != read[0]) read.push_back(r);
+        }
+        int slot = (history.frames + HISTORY - 1) % HISTORY;
+        if (history.frames > 0) {
+            for (Stage &s : history.stages) s.ms[slot] = 0;
+            history.frame_ms[slot] = (t - history.start[slot]) / 1e6f;
+        }
+        for (const Ring *r : read) {
+            auto seen = std::find_if(history.seen.begin(), history.seen.end(), [r](const auto &s) { return s.first == r; });
+            if (seen == history.seen.end()) {
+                history.seen.push_back({r, r->head.load(std::memory_order_acquire)});
+                continue;
+            }
+            unsigned long long head = r->head.load(std::memory_order_acquire);
+            if (history.frames > 0) {
+                unsigned long long from = std::max(seen->second, head > RING ? head - RING : 0ull);
+                for (unsigned long long h = from; h < head; h++) {
+                    Event e = r->events[h % RING];
+                    if (r->head.load(std::memory_order_acquire) > h + RING) continue;
+                    history.stage(e.name).ms[slot] += (e.end - e.start) / 1e6f;
+                }
+            }
+            seen->second = head;
+        }
+        history.start[history.frames % HISTORY] = t;
+        history.frames++;
+    }
+
+    // average, 99th percentile and latest value of every stage over the last `frames` frames
+    // NOTE: the first entry is the whole frame
+    std::vector<Stat> stats(int frames = HISTORY) {
+        std::vector<Stat> out;
+        int n = std::min<unsigned long long>(std::min(frames, HISTORY), history.frames ? history.frames - 1 : 0);
+        if (n <= 0) return out;
+
+        std::vector<float> v(n);
+        auto add = [&](const char *name, const float *ms) {
+            unsigned long long last = history.frames - 2;
+            float sum = 0;
+            for (int i = 0; i < n; i++) sum += v[i] = ms[(last - i) % HISTORY];
+            int k = (int)(n * 0.99f);
+            std::nth_element(v.begin(), v.begin() + std::min(k, n - 1), v.end());
+            out.push_back(Stat { name, sum / n, v[std::min(k, n - 1)], ms[last % HISTORY] });
+        };
+        add("frame", history.frame_ms);
+        for (const Stage &s : history.stages) add(s.name, s.ms);
+        return out;
+    }
+
+    // events of r that started at `since` or later
+    void copy(const Ring &r, long long since, std::vector<Event> &out) {
+        unsigned long long head = r.head.load(std::memory_order_acquire);
+        unsigned long long first = head > RING ? head - RING : 0;
+        std::vector<Event> events;
+        events.reserve(head - first);
+        for (unsigned long long h = first; h < head; h++) events.push_back(r.events[h % RING]);
+
+        // the owner kept recording while this copied, the oldest slots may hold newer events now
+        unsigned long long after = r.head.load(std::memory_order_acquire);
+        size_t lapped = after > first + RING ? std::min<unsigned long long>(after - RING - first, events.size()) : 0;
+        for (size_t i = lapped; i < events.size(); i++)
+            if (events[i].start >= since) out.push_back(events[i]);
+    }
+
+    // write the last `frames` frames of every thread as Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev)
+    bool dump(const char *path, int frames = HISTORY) {
+        FILE *f = fopen(path, "w");
+        if (!f) return false;
+
+        frames = std::min(frames, HISTORY);
+        long long since = history.frames > (unsigned long long)frames ? history.start[(history.frames - frames) % HISTORY] : 0;
+
+        std::vector<Ring *> all;
+        {
+            std::lock_guard<std::mutex> guard(registry);
+            for (auto &r : rings) all.push_back(r.get());
+        }
+
+        fprintf(f, "{\"traceEvents\": [\n");
+        bool first = true;
+        std::vector<Event> events;
+        for (Ring *r : all) {
+            fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}",
+                    first ? "" : ",\n", r->tid, r->thread, r->tid);
+            first = false;
+            events.clear();
+            copy(*r, since, events);
+            for (const Event &e : events)
+                fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                        e.name, r->tid, e.start / 1e3, (e.end - e.start) / 1e3);
+        }
+        fprintf(f, "\n]}\n");
+        return fclose(f) == 0;
+    }
+}
+
+#else
+
+#define PROFILE_SCOPE(name)
+
+namespace profile
+{
+    inline void name_thread(const char *) {}
+    inline void follow() {}
+    inline void frame() {}
+    inline std::vector<Stat> stats(int = HISTORY) { return {}; }
+    inline bool dump(const char *, int = HISTORY) { return false; }
+}
+
+#endif
@@ -0,0 +1,68 @@
+// Voxel grid raycast (Amanatides & Woo), visits only the cells the ray crosses
+#pragma once
+#include <cmath>
+#include "world.cpp"
+
+namespace raycast
+{
+    struct Hit {
+        bool hit = false;
+        int x = 0, y = 0, z = 0;     // first solid voxel
+        int nx = 0, ny = 0, nz = 0;  // normal of the face that was entered, zero when starting inside a block
+        float distance = 0;          // along the (normalized) direction
+        int steps = 0;               // cells visited
+
+        // empty cell in front of the face that was hit
+        int px() const { return x + nx; }
+        int py() const { return y + ny; }
+        int pz() const { return z + nz; }
+    };
+
+    Hit cast(const world::World &w, const float origin[3], const float direction[3], float reach) {
+        Hit h;
+        float len = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+        if (len == 0) return h;
+
+        int p[3], step[3], normal[3] = {0, 0, 0};
+        float t_max[3], t_delta[3];
+        for (int a = 0; a < 3; a++) {
+            float d = direction[a] / len;
+            p[a] = (int)floorf(origin[a]);
+            step[a] = d > 0 ? 1 : (d < 0 ? -1 : 0);
+            // ray distance to the first boundary on this axis, and between boundaries
+            t_delta[a] = step[a] ? fabsf(1.0f / d) : INFINITY;
+            t_max[a] = step[a] ? ((p[a] + (step[a] > 0)) - origin[a]) / d : INFINITY;
+        }
+
+        // the chunk the ray is in, looked up again only when it crosses into another
+        int ccx = world::chunk_of(p[0]), ccz = world::chunk_of(p[2]);
+        const world::Chunk *c = w.chunk(ccx, ccz);
+
+        float t = 0;
+        while (t <= reach) {
+            // nothing left to hit once the ray is above or below the world and moving away from it
+            if ((p[1] >= world::CHUNK_HEIGHT && step[1] >= 0) || (p[1] < 0 && step[1] <= 0)) break;
+            h.steps++;
+            if (c && p[1] >= 0 && p[1] < world::CHUNK_HEIGHT && c->get(p[0] - ccx * world::CHUNK_SIZE, p[1], p[2] - ccz * world::CHUNK_SIZE) != Air) {
+                h.hit = true;
+                h.x = p[0]; h.y = p[1]; h.z = p[2];
+                h.nx = normal[0]; h.ny = normal[1]; h.nz = normal[2];
+                h.distance = t;
+                return h;
+            }
+
+            int a = t_max[0] < t_max[1] ? (t_max[0] < t_max[2] ? 0 : 2) : (t_max[1] < t_max[2] ? 1 : 2);
+            t = t_max[a];
+            t_max[a] += t_delta[a];
+            p[a] += step[a];
+            normal[0] = normal[1] = normal[2] = 0;
+            normal[a] = -step[a];
+            if (a != 1 && (world::chunk_of(p[0]) != ccx || world::chunk_of(p[2]) != ccz)) {
+                ccx = world::chunk_of(p[0]);
+                ccz = world::chunk_of(p[2]);
+                c = w.chunk(ccx, ccz);
+            }
+        }
+        return h;
+    }
+}
@@ -0,0 +1,266 @@
+// Region files, REGION_SIZE x REGION_SIZE chunks per file behind an offset table
+// NOTE: files are memory mapped and a chunk is only decoded when it is asked for,
+// saving a chunk rewrites its own payload and table entry and nothing else
+#pragma once
+#include <cstddef>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "world.cpp"
+
+namespace region
+{
+    const int REGION_SIZE = 32;
+    const int REGION_CHUNKS = REGION_SIZE * REGION_SIZE;
+    const unsigned MAGIC = 0x47524352;  // "RCRG"
+    const unsigned VERSION = 1;
+
+    // where a chunk payload lives in the file, length 0 when the chunk was never saved
+    struct Entry {
+        unsigned offset, length;
+        unsigned capacity;  // bytes reserved at offset, a payload that still fits is rewritten in place
+    };
+
+    struct Header {
+        unsigned magic, version;
+        int seed;
+        int rx, rz;
+        unsigned reserved[3];
+        Entry table[REGION_CHUNKS];  // indexed by local z then local x
+    };
+
+    inline int region_of(int c) { return (c >= 0 ? c : c - (REGION_SIZE - 1)) / REGION_SIZE; }
+    inline int slot(int cx, int cz) {
+        return (cz - region_of(cz) * REGION_SIZE) * REGION_SIZE + cx - region_of(cx) * REGION_SIZE;
+    }
+
+    void put_varint(std::vector<unsigned char> &out, unsigned v) {
+        while (v >= 0x80) {
+            out.push_back((v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(v);
+    }
+
+    bool get_varint(const unsigned char *&p, const unsigned char *end, unsigned &v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 32; shift += 7) {
+            unsigned char b = *p++;
+            v |= (unsigned)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // palette size - 1, the block ids in order of first use, then every run of equal blocks
+    // (in world::index order) as a varint of (length - 1) * palette size + palette index
+    // NOTE: the layout is y-major, so a flat layer of terrain is usually a single run
+    void encode(const world::Chunk &c, std::vector<unsigned char> &out) {
+        int index[256];
+        unsigned char palette[256];
+        int count = 0;
+        for (int &i : index) i = -1;
+        for (int i = 0; i < world::CHUNK_VOLUME; i++) {
+            if (index[c.blocks[i]] < 0) {
+                index[c.blocks[i]] = count;
+                palette[count++] = c.blocks[i];
+            }
+        }
+
+        out.clear();
+        out.push_back(count - 1);
+        out.insert(out.end(), palette, palette + count);
+        for (int i = 0; i < world::CHUNK_VOLUME;) {
+            int j = i + 1;
+            while (j < world::CHUNK_VOLUME && c.blocks[j] == c.blocks[i]) j++;
+            put_varint(out, (unsigned)(j - i - 1) * count + index[c.blocks[i]]);
+            i = j;
+        }
+    }
+
+    // false when the payload is malformed, c is left half written then
+    bool decode(const unsigned char *p, size_t length, world::Chunk &c) {
+        const unsigned char *end = p + length;
+        if (p >= end) return false;
+        int count = *p++ + 1;
+        if (end - p < count) return false;
+        const unsigned char *palette = p;
+        p += count;
+
+        // the solid count and heightmap come from the runs, the blocks are never read back
+        c.solid = 0;
+        for (short &h : c.height) h = -1;
+        int i = 0;
+        while (i < world::CHUNK_VOLUME) {
+            unsigned v;
+            if (!get_varint(p, end, v)) return false;
+            unsigned run = v / count + 1;
+            if (run > (unsigned)(world::CHUNK_VOLUME - i)) return false;
+            unsigned char b = palette[v % count];
+            memset(c.blocks + i, b, run);
+            int j = i + run;
+            if (b != Air) {
+                c.solid += run;
+                // only the top layer of a run can raise a column, later runs are always higher
+                for (int k = j - world::CHUNK_AREA > i ? j - world::CHUNK_AREA : i; k < j; k++)
+                    c.height[k % world::CHUNK_AREA] = k / world::CHUNK_AREA;
+            }
+            i = j;
+        }
+        return p == end;
+    }
+
+    struct Region {
+        int fd = -1;                          // -1 when there is no usable file
+        const unsigned char *map = nullptr;
+        size_t size = 0;                      // length of the file, all of it is mapped
+        Header header;
+    };
+
+    // a directory of region files for one seed, safe to load from several threads at once, the decoding runs in parallel
+    struct Store {
+        std::string dir;
+        int seed;
+
+        std::mutex lock;
+        std::unordered_map<long long, std::unique_ptr<Region>> regions;
+        size_t loaded = 0, saved = 0, written = 0;  // chunks and payload bytes
+
+        Store(const std::string &dir, int seed) : dir(dir), seed(seed) {
+            // mkdir -p
+            for (size_t i = 1; i <= dir.size(); i++)
+                if (i == dir.size() || dir[i] == '/') mkdir(dir.substr(0, i).c_str(), 0755);
+        }
+
+        ~Store() {
+            for (auto &it : regions) close(*it.second);
+        }
+
+        std::string path(int rx, int rz) const {
+            return dir + "/r." + std::to_string(rx) + "." + std::to_string(rz) + ".rgn";
+        }
+
+        static void close(Region &r) {
+            if (r.map) munmap((void *)r.map, r.size);
+            if (r.fd >= 0) ::close(r.fd);
+            r.map = nullptr;
+            r.fd = -1;
+        }
+
+        static bool remap(Region &r) {
+            struct stat st;
+            if (r.map) munmap((void *)r.map, r.size);
+            r.map = nullptr;
+            if (fstat(r.fd, &st) != 0) return false;
+            r.size = st.st_size;
+            void *m = mmap(nullptr, r.size, PROT_READ, MAP_SHARED, r.fd, 0);
+            if (m == MAP_FAILED) return false;
+            r.map = (const unsigned char *)m;
+            return true;
+        }
+
+        // the region holding chunk (cx, cz), or null when its file is missing (and not created) or unusable
+        // NOTE: caller holds the lock
+        Region *open(int cx, int cz, bool create) {
+            int rx = region_of(cx), rz = region_of(cz);
+            std::unique_ptr<Region> &r = regions[world::key(rx, rz)];
+            if (!r) r.reset(new Region());
+            if (r->fd >= 0) return r.get();
+            // missing files are remembered, so chunks out of any saved region don't retry the open
+            if (r->size == (size_t)-1 && !create) return nullptr;
+
+            r->size = (size_t)-1;
+            int fd = ::open(path(rx, rz).c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+            if (fd < 0) return nullptr;
+
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size == 0) {
+                Header h = {};
+                h.magic = MAGIC;
+                h.version = VERSION;
+                h.seed = seed;
+                h.rx = rx;
+                h.rz = rz;
+                if (pwrite(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) { ::close(fd); return nullptr; }
+            }
+
+            r->fd = fd;
+            bool usable = remap(*r) && r->size >= sizeof(Header);
+            if (usable) {
+                memcpy(&r->header, r->map, sizeof(Header));
+                const Header &h = r->header;
+                usable = h.magic == MAGIC && h.version == VERSION && h.seed == seed && h.rx == rx && h.rz == rz;
+            }
+            if (!usable) {
+                // NOTE: never written to either, a file of another seed or version is left as it is
+                close(*r);
+                r->size = (size_t)-1;
+                return nullptr;
+            }
+            return r.get();
+        }
+
+        // fill c from its saved payload, false when it was never saved
+        // NOTE: the payload is copied out under the lock and decoded after it, as a save can rewrite it in place
+        // or remap the file; only the lookup and the copy are serialized
+        bool load(world::Chunk &c) {
+            static thread_local std::vector<unsigned char> buffer;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                Region *r = open(c.cx, c.cz, false);
+                if (!r) return false;
+                const Entry &e = r->header.table[slot(c.cx, c.cz)];
+                if (!e.length || (size_t)e.offset + e.length > r->size) return false;
+                buffer.assign(r->map + e.offset, r->map + e.offset + e.length);
+            }
+            if (!decode(buffer.data(), buffer.size(), c)) {
+                memset(c.blocks, Air, sizeof(c.blocks));
+                c.recount();
+                return false;
+            }
+            c.unsaved = false;
+            std::lock_guard<std::mutex> guard(lock);
+            loaded++;
+            return true;
+        }
+
+        bool save(world::Chunk &c) {
+            static thread_local std::vector<unsigned char> buffer;
+            encode(c, buffer);
+
+            std::lock_guard<std::mutex> guard(lock);
+            Region *r = open(c.cx, c.cz, true);
+            if (!r) return false;
+            int s = slot(c.cx, c.cz);
+            Entry e = r->header.table[s];
+            // the file only grows, a payload that outgrew its place moves to the end
+            if (buffer.size() > e.capacity) {
+                e.offset = r->size;
+                e.capacity = buffer.size();
+            }
+            e.length = buffer.size();
+
+            // payload first, so the table never points at bytes that are not there yet
+            if (pwrite(r->fd, buffer.data(), e.length, e.offset) != (ssize_t)e.length) return false;
+            size_t at = offsetof(Header, table) + s * sizeof(Entry);
+            if (pwrite(r->fd, &e, sizeof(e), at) != (ssize_t)sizeof(e)) return false;
+            r->header.table[s] = e;
+            if (e.offset + e.length > r->size && !remap(*r)) { close(*r); return false; }
+
+            c.unsaved = false;
+            saved++;
+            written += e.length;
+            return true;
+        }
+
+        // write every chunk changed since it was loaded or last saved, returns how many were written
+        size_t save(world::World &w) {
+            size_t n = 0;
+            for (auto &it : w.chunks)
+                if (it.second->unsaved && save(*it.second)) n++;
+            return n;
+        }
+    };
+}
@@ -0,0 +1,222 @@
+// CPU voxel renderer, raymarches the world from a camera into an rgba image, tiles spread over the job pool
+// NOTE: no raylib or GPU in here, for map previews, golden images and timing the voxel traversal
+#pragma once
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "jobs.cpp"
+#include "mesher.cpp"
+#include "png.cpp"
+#include "raycast.cpp"
+
+namespace render
+{
+    const int TILE = 16;  // tile size in pixels, the unit of work
+    const unsigned char SKY[4] = {255, 255, 255, 255};   // the game clears to white
+    const unsigned char INSIDE[4] = {0, 0, 0, 255};      // rays starting inside a block
+
+    // the fields of a raylib Camera3D that matter here
+    struct View {
+        float position[3] = {0, 0, 0};
+        float target[3] = {0, 0, 1};
+        float up[3] = {0, 1, 0};
+        float fovy = 60;  // vertical, in degrees
+        float far = 160;  // rays give up after this many blocks
+    };
+
+    // from a Camera3D (or anything with the same members)
+    template <typename Camera>
+    View view(const Camera &c, float far = 160) {
+        View v;
+        v.position[0] = c.position.x; v.position[1] = c.position.y; v.position[2] = c.position.z;
+        v.target[0] = c.target.x; v.target[1] = c.target.y; v.target[2] = c.target.z;
+        v.up[0] = c.up.x; v.up[1] = c.up.y; v.up[2] = c.up.z;
+        v.fovy = c.fovy;
+        v.far = far;
+        return v;
+    }
+
+    // the lamp tile, there is no png for it: a warm glass pane in a dark frame
+    inline void lamp(png::Image &t) {
+        t.resize(16, 16);
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 16; x++) {
+                unsigned char *p = t.at(x, y);
+                bool frame = x == 0 || y == 0 || x == 15 || y == 15 || x == 7 || y == 7;
+                int glow = 255 - 4 * (abs(2 * x - 15) + abs(2 * y - 15));
+                p[0] = frame ? 90 : 255;
+                p[1] = frame ? 70 : (unsigned char)(glow * 220 / 255);
+                p[2] = frame ? 50 : (unsigned char)(glow * 120 / 255);
+                p[3] = 255;
+            }
+        }
+    }
+
+    // where the block pngs are, for these and for the atlas the game draws with
+    const char *const RESOURCES = "./resource";
+
+    // block textures indexed by mesher::tile, like the atlas the game draws with
+    struct Textures {
+        png::Image tiles[mesher::TILE_COUNT];
+        bool loaded = false;  // false when the pngs were missing and flat colours stand in
+
+        bool load(const char *dir) {
+            std::string d(dir);
+            png::Image dirt, stone, grass;
+            loaded = png::load((d + "/dirt_block.png").c_str(), dirt) && png::load((d + "/stone_block.png").c_str(), stone) &&
+                     png::load((d + "/grass_block.png").c_str(), grass) && grass.width >= 6 * grass.height;
+            if (!loaded) {
+                // dirt, stone, then grass front, back, top, bottom, right, left, then lamp
+                const unsigned char flat[mesher::TILE_COUNT][3] = {
+                    {134, 96, 67}, {125, 125, 125}, {110, 120, 60}, {110, 120, 60},
+                    {96, 159, 56}, {134, 96, 67}, {110, 120, 60}, {110, 120, 60}, {255, 210, 120}
+                };
+                for (int t = 0; t < mesher::TILE_COUNT; t++) {
+                    tiles[t].resize(16, 16);
+                    for (int i = 0; i < 16 * 16; i++) {
+                        memcpy(&tiles[t].rgba[i * 4], flat[t], 3);
+                        tiles[t].rgba[i * 4 + 3] = 255;
+                    }
+                }
+                return false;
+            }
+            tiles[0] = dirt;
+            tiles[1] = stone;
+            // the grass strip holds front, back, top, bottom, right, left
+            int s = grass.height;
+            for (int f = 0; f < 6; f++) {
+                png::Image &t = tiles[2 + f];
+                t.resize(s, s);
+                for (int y = 0; y < s; y++) memcpy(t.at(0, y), grass.at(f * s, y), s * 4);
+            }
+            lamp(tiles[8]);
+            return true;
+        }
+    };
+
+    // texture coordinates on face f as uv = a + pu * du + pv * dv, pu and pv the hit position along the
+    // face's u and v axes within the block; worked out from the mesher's corners so it matches the game
+    struct FaceUV {
+        float a[2], du[2], dv[2];
+    };
+
+    inline const FaceUV *face_uvs() {
+        static const auto table = []() {
+            std::array<FaceUV, 6> t;
+            for (int f = 0; f < 6; f++) {
+                int ua = mesher::FACE_U_AXIS[f], va = mesher::FACE_V_AXIS[f];
+                const float *at[2][2];
+                for (int i = 0; i < 4; i++) at[(int)mesher::FACE_CORNERS[f][i][ua]][(int)mesher::FACE_CORNERS[f][i][va]] = mesher::FACE_UVS[f][i];
+                for (int k = 0; k < 2; k++) {
+                    t[f].a[k] = at[0][0][k];
+                    t[f].du[k] = at[1][0][k] - at[0][0][k];
+                    t[f].dv[k] = at[0][1][k] - at[0][0][k];
+                }
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // mesher::Face of a hit normal, -1 for none
+    inline int face_of(int nx, int ny, int nz) {
+        if (nz) return nz > 0 ? mesher::Front : mesher::Back;
+        if (ny) return ny > 0 ? mesher::Top : mesher::Bottom;
+        if (nx) return nx > 0 ? mesher::Right : mesher::Left;
+        return -1;
+    }
+
+    struct Renderer {
+        jobs::Pool &pool;
+        int channel;
+        png::Image frame;
+        long long rays = 0, steps = 0;  // of the last draw(), steps are grid cells visited
+        long long stolen = 0;           // tiles of the last draw() taken from another thread's run
+
+        Renderer(jobs::Pool &pool) : pool(pool), channel(pool.channel("render")) {}
+
+        int threads() const { return pool.workers() + 1; }
+
+        // one ray through every pixel centre, sampled with the game's textures and point filtering
+        void draw(const world::World &w, const View &v, const Textures &tex, int width, int height) {
+            frame.resize(width, height);
+
+            float f[3], r[3], u[3];
+            for (int a = 0; a < 3; a++) f[a] = v.target[a] - v.position[a];
+            normalize(f);
+            cross(f, v.up, r);
+            normalize(r);
+            cross(r, f, u);
+            float half = tanf(v.fovy * 3.14159265f / 360.0f), aspect = (float)width / height;
+
+            int columns = (width + TILE - 1) / TILE, rows = (height + TILE - 1) / TILE;
+            std::atomic<long long> total{0};
+            const FaceUV *uvs = face_uvs();
+            long long before = pool.channels[channel].stolen;
+            pool.run(channel, columns * rows, [&](int t) {
+                int x0 = (t % columns) * TILE, y0 = (t / columns) * TILE;
+                long long visited = 0;
+                for (int y = y0; y < std::min(y0 + TILE, height); y++) {
+                    float sy = (1 - 2 * (y + 0.5f) / height) * half;
+                    for (int x = x0; x < std::min(x0 + TILE, width); x++) {
+                        float sx = (2 * (x + 0.5f) / width - 1) * half * aspect;
+                        float d[3] = {f[0] + sx * r[0] + sy * u[0], f[1] + sx * r[1] + sy * u[1], f[2] + sx * r[2] + sy * u[2]};
+                        normalize(d);
+                        visited += shade(w, v, tex, uvs, d, frame.at(x, y));
+                    }
+                }
+                total += visited;
+            });
+            rays = (long long)width * height;
+            steps = total;
+            stolen = pool.channels[channel].stolen - before;
+        }
+
+        // colour of the ray from the camera along d (normalized), returns the cells visited
+        static int shade(const world::World &w, const View &v, const Textures &tex, const FaceUV *uvs, const float d[3], unsigned char *out) {
+            // start where the ray enters the blocks' height range, rays above it and pointing up see sky
+            float o[3] = {v.position[0], v.position[1], v.position[2]}, skip = 0;
+            if (o[1] >= world::CHUNK_HEIGHT) skip = d[1] < 0 ? (o[1] - world::CHUNK_HEIGHT) / -d[1] : INFINITY;
+            else if (o[1] < 0) skip = d[1] > 0 ? -o[1] / d[1] : INFINITY;
+            if (skip > v.far) {
+                memcpy(out, SKY, 4);
+                return 0;
+            }
+            for (int a = 0; a < 3; a++) o[a] += d[a] * skip;
+
+            raycast::Hit h = raycast::cast(w, o, d, v.far - skip);
+            int face = face_of(h.nx, h.ny, h.nz);
+            if (!h.hit) memcpy(out, SKY, 4);
+            else if (face < 0) memcpy(out, INSIDE, 4);
+            else {
+                const int block[3] = {h.x, h.y, h.z};
+                int ua = mesher::FACE_U_AXIS[face], va = mesher::FACE_V_AXIS[face];
+                float pu = o[ua] + d[ua] * h.distance - block[ua], pv = o[va] + d[va] * h.distance - block[va];
+                pu = std::min(std::max(pu, 0.0f), 1.0f);
+                pv = std::min(std::max(pv, 0.0f), 1.0f);
+                const FaceUV &m = uvs[face];
+                float tu = m.a[0] + pu * m.du[0] + pv * m.dv[0], tv = m.a[1] + pu * m.du[1] + pv * m.dv[1];
+
+                const png::Image &t = tex.tiles[mesher::tile(w.get(h.x, h.y, h.z), face)];
+                int tx = std::min((int)(tu * t.width), t.width - 1), ty = std::min((int)(tv * t.height), t.height - 1);
+                memcpy(out, t.at(tx, ty), 3);
+                out[3] = 255;
+            }
+            return h.steps;
+        }
+
+        static void normalize(float v[3]) {
+            float l = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            if (l > 0) for (int a = 0; a < 3; a++) v[a] /= l;
+        }
+
+        static void cross(const float a[3], const float b[3], float out[3]) {
+            out[0] = a[1] * b[2] - a[2] * b[1];
+            out[1] = a[2] * b[0] - a[0] * b[2];
+            out[2] = a[0] * b[1] - a[1] * b[0];
+        }
+    };
+}
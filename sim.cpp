@@ -0,0 +1,269 @@
+// Player simulation, one step per tick: first person look, walking and jumping swept against the blocks, picking and edits
+// NOTE: no raylib in here, the game and headless replays run the very same steps
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+#include "collide.cpp"
+#include "edit.cpp"
+#include "input.cpp"
+#include "raycast.cpp"
+#include "stream.cpp"
+
+namespace sim
+{
+    const float CUBE = 1.f;
+    const float CAM_HEIGHT = 4 * CUBE;
+    const float JUMP_HEIGHT = 2 * CUBE;
+    const float REACH = 6 * CUBE;
+    const float SPAWN_X = 8.5f, SPAWN_Z = 8.5f;
+
+    // the player's box, the camera is EYE above its floor
+    const float EYE = CAM_HEIGHT - CUBE;  // where the camera always was, CAM_HEIGHT above the top block's y
+    const float PLAYER_RADIUS = 0.3f * CUBE;
+    const float PLAYER_HEIGHT = EYE + 0.2f * CUBE;
+    const float STEP_HEIGHT = CUBE;  // walked up without a jump
+    const float GRAVITY = 24 * CUBE;  // per second squared
+    const float MAX_FALL = 40 * CUBE;  // per second
+    const float JUMP_SPEED = sqrtf(2 * GRAVITY * (JUMP_HEIGHT + 0.25f * CUBE));  // clears a JUMP_HEIGHT wall
+
+    // first person camera, same numbers as the raylib camera module it came from
+    const float MOUSE_SENSITIVITY = 0.003f;
+    const float PITCH_CLAMP = 89.0f * 3.14159265358979323846f / 180.0f;
+    const float PANNING_DIVIDER = 5.1f;
+
+    struct Player {
+        float position[3] = {SPAWN_X, CAM_HEIGHT, SPAWN_Z};
+        float target[3] = {0, 0, 0};
+        float angle[2] = {0, 0};  // yaw (0 along +z) and pitch
+        float target_distance = 0;
+        float speed = 5;          // movement divider, lower is faster
+        float velocity = 0;       // upwards, per second
+        bool grounded = false;    // standing on something after the last step
+        bool free_observe = false;
+
+        collide::Body body() const {
+            collide::Body b {{position[0], position[1] - EYE, position[2]}, PLAYER_RADIUS, PLAYER_HEIGHT};
+            return b;
+        }
+
+        void place(const collide::Body &b) {
+            position[0] = b.position[0];
+            position[1] = b.position[1] + EYE;
+            position[2] = b.position[2];
+        }
+
+        // look angles from where the camera points
+        void aim() {
+            float dx = target[0] - position[0], dy = target[1] - position[1], dz = target[2] - position[2];
+            target_distance = sqrtf(dx * dx + dy * dy + dz * dz);
+            angle[0] = atan2f(dx, dz);
+            angle[1] = atan2f(dy, sqrtf(dx * dx + dz * dz));
+        }
+
+        // where the held buttons walk to this step, up and down only counts when flying
+        void walk(unsigned short down, float d[3]) const {
+            bool front = down & input::Forward, back = down & input::Back;
+            bool right = down & input::Right, left = down & input::Left;
+            float sx = sinf(angle[0]), cx = cosf(angle[0]), sy = sinf(angle[1]);
+            d[0] = (sx * back - sx * front - cx * left + cx * right) / speed;
+            d[1] = (sy * front - sy * back) / speed;
+            d[2] = (cx * back - cx * front + sx * left - sx * right) / speed;
+        }
+
+        // turn with the mouse, the target follows
+        void look(const float mouse[2]) {
+            angle[0] += mouse[0] * -MOUSE_SENSITIVITY;
+            angle[1] += mouse[1] * -MOUSE_SENSITIVITY;
+            if (angle[1] > PITCH_CLAMP) angle[1] = PITCH_CLAMP;
+            else if (angle[1] < -PITCH_CLAMP) angle[1] = -PITCH_CLAMP;
+
+            // the translation * rotation matrix product of the camera module, worked out
+            float d = target_distance / PANNING_DIVIDER;
+            target[0] = position[0] - d * sinf(angle[0]) * cosf(angle[1]);
+            target[1] = position[1] + d * sinf(angle[1]);
+            target[2] = position[2] - d * cosf(angle[0]) * cosf(angle[1]);
+        }
+    };
+
+    struct Game {
+        world::World level;
+        world::Terrain terrain;
+        world::EditQueue edits;
+        std::vector<std::function<void()>> bulk;  // bulk edits asked for last step, applied with the clicks
+        edit::Journal journal;
+        edit::Clip clip;
+        int corner[2][3] = {{0, 0, 0}, {0, 0, 0}};
+        int marked = 0;                        // corners set so far, the selection is there from two
+        std::unordered_set<long long> edited;  // chunks with a stale mesh, whoever meshes them clears it
+        Player player;
+        raycast::Hit pick;                     // block under the crosshair after the last step
+        double time = 0;                       // simulated seconds
+        double respawned_at = -10;
+        bool ground_loaded = false;            // every chunk under the player is there, it floats until they are
+        int lookups = 0;                       // cells the last step's collision looked at
+        size_t steps = 0;
+
+        // highest y in (x,z), or the lowest solid y
+        float tallest(float _x, float _z, bool tallest = true) const {
+            PROFILE_SCOPE("ground");
+            int px = floorf(_x), pz = floorf(_z);
+            if (tallest) {
+                int h = level.top(px, pz);
+                return h < 0 ? 0 : h;
+            }
+            for (int y = 0; y < world::CHUNK_HEIGHT; y++) {
+                if (level.solid(px, y, pz)) return y;
+            }
+            return 0;
+        }
+
+        // the chunks around spawn are loaded (or generated) right away so there is ground to stand on
+        void load_spawn(stream::Streamer &streamer, region::Store *store) {
+            int scx = world::chunk_of(SPAWN_X), scz = world::chunk_of(SPAWN_Z);
+            for (int cx = scx - 1; cx <= scx + 1; cx++) {
+                for (int cz = scz - 1; cz <= scz + 1; cz++) {
+                    world::Chunk *c = new world::Chunk(cx, cz);
+                    if (!store || !store->load(*c)) world::generate(*c, terrain);
+                    light::seed(*c);
+                    level.chunks[world::key(cx, cz)].reset(c);
+                    std::unordered_set<long long> lit;
+                    light::join(level, cx, cz, lit);
+                    streamer.mark(level, cx, cz);
+                }
+            }
+            player.aim();
+            player.position[1] = tallest(player.position[0], player.position[2]) + CAM_HEIGHT;
+        }
+
+        // light around a changed block; chunks it changed in get a new mesh, and a mesh started before is thrown away
+        void relight(int x, int y, int z, CubeType was) {
+            PROFILE_SCOPE("light");
+            std::unordered_set<long long> lit;
+            light::update(level, x, y, z, was, lit);
+            for (long long k : lit) {
+                auto it = level.chunks.find(k);
+                if (it != level.chunks.end() && edited.insert(k).second) it->second->revision++;
+            }
+        }
+
+        // the box between the two corners, or an empty one; the stone floor at y = 0 is never in it
+        edit::Box selection() const {
+            if (marked < 2) return edit::Box();
+            edit::Box b = edit::Box::between(corner[0][0], corner[0][1], corner[0][2], corner[1][0], corner[1][1], corner[1][2]);
+            b.y0 = std::max(b.y0, 1);
+            return b;
+        }
+
+        int chunk_x() const { return world::chunk_of(floorf(player.position[0])); }
+        int chunk_z() const { return world::chunk_of(floorf(player.position[2])); }
+
+        void step(const input::Input &in) {
+            Player &p = player;
+            time += in.dt;
+            steps++;
+
+            // last step's clicks, the chunks they touched go to `edited`
+            {
+                PROFILE_SCOPE("edits");
+                edits.apply(level, edited, [this](int x, int y, int z, CubeType was) { relight(x, y, z, was); });
+                for (auto &f : bulk) f();
+                bulk.clear();
+            }
+
+            if (in.pressed & input::Respawn) {
+                p.position[0] = SPAWN_X;
+                p.position[2] = SPAWN_Z;
+                p.position[1] = tallest(p.position[0], p.position[2]) + CAM_HEIGHT;
+                p.velocity = 0;
+                respawned_at = time;
+            }
+
+            // toggle free observe mode
+            if (in.pressed & input::FreeObserve) p.free_observe = !p.free_observe;
+
+            p.speed = (in.down & input::Slow) ? 3 : 5;
+
+            float d[3];
+            p.walk(in.down, d);
+            if (p.free_observe) {
+                // flying goes through everything
+                for (int k = 0; k < 3; k++) p.position[k] += d[k];
+                p.velocity = 0;
+                p.grounded = false;
+            } else {
+                PROFILE_SCOPE("collide");
+                collide::Body b = p.body();
+                ground_loaded = collide::loaded(level, b);
+                d[1] = 0;
+                if (ground_loaded) {
+                    // an edit or a respawn may have put blocks where the player is
+                    if (collide::unstick(level, b)) p.velocity = 0;
+                    if ((in.pressed & input::Jump) && p.grounded) p.velocity = JUMP_SPEED;
+                    p.velocity = std::max(p.velocity - GRAVITY * in.dt, -MAX_FALL);
+                    d[1] = p.velocity * in.dt;
+                } else {
+                    p.velocity = 0;
+                }
+                collide::Result r = collide::move(level, b, d, p.grounded ? STEP_HEIGHT : 0);
+                if (r.ground || r.ceiling) p.velocity = 0;
+                p.grounded = r.ground;
+                p.place(b);
+                lookups = b.lookups;
+            }
+
+            {
+                PROFILE_SCOPE("camera");
+                p.look(in.mouse);
+            }
+
+            // pick the first block the view ray crosses within reach, clicks are applied next step
+            PROFILE_SCOPE("pick");
+            float direction[3] = {p.target[0] - p.position[0], p.target[1] - p.position[1], p.target[2] - p.position[2]};
+            pick = raycast::cast(level, p.position, direction, REACH);
+            if (pick.hit) {
+                if ((in.pressed & input::Break) && level.get(pick.x, pick.y, pick.z) != CubeType::Stone) {
+                    edits.push(pick.x, pick.y, pick.z, CubeType::Air);
+                }
+                // place against the face that was hit
+                bool inside = pick.nx == 0 && pick.ny == 0 && pick.nz == 0;
+                // not into the player's own box, unless it flies
+                collide::Body b = p.body();
+                int px = pick.px(), py = pick.py(), pz = pick.pz();
+                bool blocking = !p.free_observe && px + 1 > b.min(0) && px < b.max(0) && py + 1 > b.min(1) && py < b.max(1) &&
+                                pz + 1 > b.min(2) && pz < b.max(2);
+                if ((in.pressed & input::Place) && !inside && !blocking) {
+                    edits.push(pick.px(), pick.py(), pick.pz(), CubeType::Dirt);
+                } else if ((in.pressed & input::PlaceLamp) && !inside && !blocking) {
+                    edits.push(pick.px(), pick.py(), pick.pz(), CubeType::Lamp);
+                }
+                if (in.pressed & input::Mark) {
+                    int *c = corner[marked++ % 2];
+                    c[0] = pick.x;
+                    c[1] = pick.y;
+                    c[2] = pick.z;
+                }
+                if ((in.pressed & input::Paste) && !inside) {
+                    int x = pick.px(), y = pick.py(), z = pick.pz();
+                    bulk.push_back([this, x, y, z]() { edit::paste(level, clip, x, y, z, edited, &journal); });
+                }
+            }
+
+            edit::Box b = selection();
+            if (in.pressed & input::Fill) {
+                CubeType t = (in.down & input::Slow) ? CubeType::Air : CubeType::Dirt;
+                bulk.push_back([this, b, t]() { edit::fill(level, b, t, edited, &journal); });
+            }
+            if (in.pressed & input::Copy) bulk.push_back([this, b]() { clip = edit::copy(level, b); });
+            if (in.pressed & input::Undo) {
+                bool redo = in.down & input::Slow;
+                bulk.push_back([this, redo]() {
+                    if (redo) journal.redo(level, edited);
+                    else journal.undo(level, edited);
+                });
+            }
+        }
+    };
+}
@@ -0,0 +1,243 @@
+// Background chunk streaming in a ring around the player, on the shared job pool
+// NOTE: jobs never touch the live world, they generate from the terrain settings and
+// mesh from a copy of the chunk and its neighbours; only the thread that owns the world (the tick thread) changes `World`
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include "jobs.cpp"
+#include "light.cpp"
+#include "lod.cpp"
+#include "mesher.cpp"
+#include "profile.cpp"
+#include "region.cpp"
+
+namespace stream
+{
+    // a finished job, either a generated chunk or a chunk mesh
+    struct Result {
+        int cx, cz;
+        unsigned revision = 0;  // of the chunk the mesh was built from
+        std::unique_ptr<world::Chunk> chunk;
+        std::unique_ptr<mesher::ChunkMesh> mesh;
+    };
+
+    struct Streamer {
+        jobs::Pool &pool;
+        const world::Terrain *terrain;
+        region::Store *store = nullptr;  // optional, saved chunks are loaded from it instead of generated
+        int radius;  // chunks further than this (on either axis) are evicted
+        int generate_channel, mesh_channel, lod_channel, save_channel;
+
+        // the world owner's thread only
+        std::vector<Result> done;  // handed over by the pool's complete()
+        std::unordered_set<long long> generating;
+        std::unordered_set<long long> dirty;  // loaded chunks waiting for a mesh
+        std::unordered_set<long long> meshing;
+        std::unordered_set<long long> building;  // lod tiles, by lod::key
+        std::unordered_map<long long, std::shared_ptr<world::Chunk>> saving;  // evicted, being written to the store
+
+        Streamer(jobs::Pool &pool, const world::Terrain *terrain, int radius = 6)
+            : pool(pool), terrain(terrain), radius(radius), generate_channel(pool.channel("generate")),
+              mesh_channel(pool.channel("mesh")), lod_channel(pool.channel("lod")), save_channel(pool.channel("save")) {}
+
+        // queued work is dropped, saves are not; the `done` of what was running is run here, not on a later drain()
+        ~Streamer() {
+            for (int ch : {generate_channel, mesh_channel, lod_channel}) pool.cancel(ch);
+            pool.wait();
+            pool.complete(INFINITY);
+        }
+
+        void submit(int channel, int priority, std::function<Result()> run) {
+            std::shared_ptr<Result> r(new Result());
+            pool.submit(channel, priority, [r, run]() { *r = run(); }, [this, r]() { done.push_back(std::move(*r)); });
+        }
+
+        // chunks next to the player's go first, the rest in the order they were queued
+        static int priority(int distance) { return distance <= 1 ? jobs::Near : jobs::Normal; }
+
+        size_t pending() const { return generating.size() + meshing.size() + building.size() + saving.size(); }
+
+        static int distance(int cx, int cz, int pcx, int pcz) {
+            int dx = abs(cx - pcx), dz = abs(cz - pcz);
+            return dx > dz ? dx : dz;
+        }
+
+        // queue loading (or generation) of missing chunks around (pcx, pcz), nearest first, and evict the far ones
+        void update(world::World &w, int pcx, int pcz, const std::function<void(int, int)> &evicted) {
+            for (int d = 0; d <= radius; d++) {
+                for (int cx = pcx - d; cx <= pcx + d; cx++) {
+                    for (int cz = pcz - d; cz <= pcz + d; cz++) {
+                        if (distance(cx, cz, pcx, pcz) != d) continue;
+                        long long k = world::key(cx, cz);
+                        // one still being saved comes back from the store once it is written
+                        if (w.chunks.count(k) || generating.count(k) || saving.count(k)) continue;
+                        generating.insert(k);
+                        const world::Terrain *t = terrain;
+                        region::Store *s = store;
+                        submit(generate_channel, priority(d), [t, s, cx, cz]() {
+                            Result r;
+                            r.cx = cx;
+                            r.cz = cz;
+                            r.chunk.reset(new world::Chunk(cx, cz));
+                            PROFILE_SCOPE("generate");
+                            if (!s || !s->load(*r.chunk)) world::generate(*r.chunk, *t);
+                            light::seed(*r.chunk);
+                            return r;
+                        });
+                    }
+                }
+            }
+
+            for (auto it = w.chunks.begin(); it != w.chunks.end();) {
+                const world::Chunk &c = *it->second;
+                if (distance(c.cx, c.cz, pcx, pcz) > radius) {
+                    evicted(c.cx, c.cz);
+                    dirty.erase(it->first);
+                    // only changed chunks are written, the rest are still in the region file as they are
+                    if (store && c.unsaved) save(it->first, std::move(it->second));
+                    it = w.chunks.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+
+        // schedule mesh jobs for dirty chunks that have all four neighbours loaded, for up to `budget` seconds
+        void schedule(world::World &w, int pcx, int pcz, double budget) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (auto it = dirty.begin(); it != dirty.end();) {
+                if (std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() > budget) break;
+                const world::Chunk *c = w.chunks.at(*it).get();
+                int cx = c->cx, cz = c->cz;
+                if (meshing.count(*it) || !w.chunk(cx - 1, cz) || !w.chunk(cx + 1, cz) || !w.chunk(cx, cz - 1) || !w.chunk(cx, cz + 1)) {
+                    it++;
+                    continue;
+                }
+
+                // the mesher only looks one block past the border, so the neighbours are enough; the diagonal
+                // ones only shade the corner blocks and are copied when they are there
+                std::shared_ptr<world::World> snap(new world::World());
+                for (int dx = -1; dx <= 1; dx++) {
+                    for (int dz = -1; dz <= 1; dz++) {
+                        const world::Chunk *src = w.chunk(cx + dx, cz + dz);
+                        if (src) snap->chunks[world::key(src->cx, src->cz)].reset(new world::Chunk(*src));
+                    }
+                }
+                unsigned revision = c->revision;
+                meshing.insert(*it);
+                it = dirty.erase(it);
+
+                submit(mesh_channel, priority(distance(cx, cz, pcx, pcz)), [snap, cx, cz, revision]() {
+                    Result r;
+                    r.cx = cx;
+                    r.cz = cz;
+                    r.revision = revision;
+                    PROFILE_SCOPE("mesh");
+                    r.mesh.reset(new mesher::ChunkMesh());
+                    mesher::build(*snap, cx, cz, *r.mesh);
+                    return r;
+                });
+            }
+        }
+
+        // write an evicted chunk in the background, it is not loaded again before that is done
+        void save(long long k, std::unique_ptr<world::Chunk> chunk) {
+            std::shared_ptr<world::Chunk> c(std::move(chunk));
+            saving[k] = c;
+            region::Store *s = store;
+            pool.submit(save_channel, jobs::Background, [s, c]() {
+                PROFILE_SCOPE("save");
+                s->save(*c);
+            }, [this, k, c]() {
+                auto it = saving.find(k);
+                if (it != saving.end() && it->second == c) saving.erase(it);
+            });
+        }
+
+        // build a lod tile from the terrain settings, it comes back through drain() with its mesh's lod set
+        // NOTE: behind every chunk job, the chunks are what the player is standing on
+        void build(int level, int tx, int tz) {
+            if (!building.insert(lod::key(level, tx, tz)).second) return;
+            const world::Terrain *t = terrain;
+            submit(lod_channel, jobs::Far, [t, level, tx, tz]() {
+                Result r;
+                r.cx = tx;
+                r.cz = tz;
+                PROFILE_SCOPE("lod");
+                r.mesh.reset(new mesher::ChunkMesh());
+                lod::build(*t, level, tx, tz, *r.mesh);
+                return r;
+            });
+        }
+
+        void mark(world::World &w, int cx, int cz) {
+            if (w.chunk(cx, cz)) dirty.insert(world::key(cx, cz));
+        }
+
+        // hand finished work to the world until `budget` seconds are spent, meshes go to `meshed`
+        void drain(world::World &w, double budget, const std::function<void(const mesher::ChunkMesh &)> &meshed) {
+            auto t0 = std::chrono::steady_clock::now();
+            pool.complete(budget);
+            std::vector<Result> batch;
+            batch.swap(done);
+
+            std::unordered_set<long long> lit;
+            size_t i = 0;
+            for (; i < batch.size(); i++) {
+                if (std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() > budget) break;
+                Result &r = batch[i];
+                long long k = world::key(r.cx, r.cz);
+
+                if (r.chunk) {
+                    generating.erase(k);
+                    // the player may have moved on while it was generated
+                    if (w.chunks.count(k)) continue;
+                    w.chunks[k] = std::move(r.chunk);
+                    // new faces for the chunk itself, hidden faces for its neighbours, and new light wherever it reached
+                    mark(w, r.cx, r.cz);
+                    mark(w, r.cx - 1, r.cz);
+                    mark(w, r.cx + 1, r.cz);
+                    mark(w, r.cx, r.cz - 1);
+                    mark(w, r.cx, r.cz + 1);
+                    lit.clear();
+                    {
+                        PROFILE_SCOPE("light");
+                        light::join(w, r.cx, r.cz, lit);
+                    }
+                    for (long long n : lit)
+                        if (w.chunks.count(n)) dirty.insert(n);
+                } else if (r.mesh->lod) {
+                    building.erase(lod::key(r.mesh->lod, r.cx, r.cz));
+                    meshed(*r.mesh);
+                } else {
+                    meshing.erase(k);
+                    const world::Chunk *c = w.chunk(r.cx, r.cz);
+                    // dropped when the chunk was evicted, and meshed again when it was edited since the snapshot
+                    if (c && c->revision == r.revision) meshed(*r.mesh);
+                    else if (c) dirty.insert(k);
+                }
+            }
+
+            // whatever did not fit in the budget waits for the next frame
+            for (; i < batch.size(); i++) done.push_back(std::move(batch[i]));
+        }
+
+        // update, then load and mesh everything around (pcx, pcz) before returning
+        // NOTE: replays stream with this, so every run sees the same chunks on the same frame
+        void settle(world::World &w, int pcx, int pcz, const std::function<void(int, int)> &evicted,
+                    const std::function<void(const mesher::ChunkMesh &)> &meshed) {
+            update(w, pcx, pcz, evicted);
+            schedule(w, pcx, pcz, INFINITY);
+            while (pending()) {
+                pool.wait();
+                drain(w, INFINITY, meshed);
+                update(w, pcx, pcz, evicted);
+                schedule(w, pcx, pcz, INFINITY);
+            }
+        }
+    };
+}
@@ -0,0 +1,241 @@
+// Fixed rate simulation thread: the game, its edits and chunk streaming step every input::FIXED_DT whatever
+// the frame rate, and every tick publishes what the frames draw and interpolate between
+// NOTE: no raylib in here; the thread owns the world while it runs, anything else reading it holds `world_lock`
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "occlusion.cpp"
+#include "sim.cpp"
+
+namespace tick
+{
+    // seconds on the clock ticks are published with
+    inline double clock() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // the camera and the rest of the game a frame shows, as of the end of one tick
+    struct State {
+        size_t tick = 0;
+        double at = 0;  // clock() when it was published
+        float position[3] = {0, 0, 0}, target[3] = {0, 0, 0};
+        float speed = 0;
+        bool free_observe = false, jumping = false, respawning = false;  // jumping is any time off the ground
+        raycast::Hit pick;
+        edit::Box selection;
+        unsigned char pocket = occlusion::ALL;  // of the camera's block, see occlusion::pocket
+        int blocks = 0, chunks = 0, pending = 0;
+        int undo = 0, redo = 0;
+        size_t journal_bytes = 0;
+        float input_ms = 0;  // from the frame handing in input to the tick that stepped with it being published, the latest
+    };
+
+    // a new mesh of a chunk or lod tile, or with none a chunk that was unloaded
+    struct Update {
+        int cx, cz;
+        std::unique_ptr<mesher::ChunkMesh> mesh;
+    };
+
+    // the camera of `b` moved `t` of the way from `a`, what is drawn between two ticks
+    // NOTE: a jump of more than a chunk (a respawn) is not smoothed over
+    inline void blend(const State &a, const State &b, float t, float position[3], float target[3]) {
+        float dx = b.position[0] - a.position[0], dy = b.position[1] - a.position[1], dz = b.position[2] - a.position[2];
+        if (dx * dx + dy * dy + dz * dz > world::CHUNK_SIZE * world::CHUNK_SIZE) t = 1;
+        for (int k = 0; k < 3; k++) {
+            position[k] = a.position[k] + (b.position[k] - a.position[k]) * t;
+            target[k] = a.target[k] + (b.target[k] - a.target[k]) * t;
+        }
+    }
+
+    struct Runner {
+        sim::Game &game;
+        stream::Streamer &streamer;
+        input::Recorder *recorder = nullptr;  // every tick's input is written to it
+        const input::Log *replay = nullptr;   // ticks step through its frames instead of the frames' input, then stop
+        double budget = 0.004;                // seconds per tick for taking in streamed work, and again for scheduling it
+
+        std::mutex world_lock;  // held through every tick
+
+        // handed between the threads, under `lock`
+        std::mutex lock;
+        input::Input inbox;               // input since the last tick took it, buttons pressed in between are kept
+        double inbox_at = 0;              // clock() of the first push() since, 0 for none
+        std::vector<int> wanted;          // level, tx, tz of lod tiles a frame asked for
+        State previous, current;
+        std::vector<Update> updates;      // since the frames last took them, in the order they happened
+        size_t ticks = 0, late = 0;       // ticks run, and those that started more than a tick late
+        size_t inputs = 0;                // ticks that stepped with pushed input
+        double input_ms = 0, input_max_ms = 0;  // the latest and the worst of those, see State::input_ms
+
+        // the tick thread's own
+        std::unordered_set<long long> meshed;  // chunks with a mesh out, an edit meshes them again
+        std::vector<Update> made;
+        std::atomic<bool> quit{false}, finished{false};
+        std::thread thread;
+
+        Runner(sim::Game &game, stream::Streamer &streamer) : game(game), streamer(streamer) {}
+        ~Runner() { stop(); }
+
+        void start() {
+            current = state();
+            current.at = clock();
+            previous = current;
+            thread = std::thread([this]() { run(); });
+        }
+
+        void stop() {
+            quit = true;
+            if (thread.joinable()) thread.join();
+        }
+
+        // a frame's input; movement adds up and pressed buttons stay pressed until the next tick
+        void push(const input::Input &in) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!inbox_at) inbox_at = clock();
+            inbox.down = in.down;
+            inbox.pressed |= in.pressed;
+            inbox.mouse[0] += in.mouse[0];
+            inbox.mouse[1] += in.mouse[1];
+        }
+
+        // a lod tile to build, for the next tick
+        void want(int level, int tx, int tz) {
+            std::lock_guard<std::mutex> guard(lock);
+            wanted.insert(wanted.end(), {level, tx, tz});
+        }
+
+        // the last two published states, and the updates since the last call
+        void take(State &a, State &b, std::vector<Update> &out) {
+            std::lock_guard<std::mutex> guard(lock);
+            a = previous;
+            b = current;
+            for (Update &u : updates) out.push_back(std::move(u));
+            updates.clear();
+        }
+
+        void run() {
+            profile::name_thread("tick");
+            profile::follow();  // the step's stages show in the overlay next to the frame's
+            const auto dt = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(input::FIXED_DT));
+            auto next = std::chrono::steady_clock::now();
+            while (!quit) {
+                if (replay && game.steps >= replay->frames.size()) break;
+                input::Input in;
+                std::vector<int> tiles;
+                double pushed;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    in = inbox;
+                    pushed = inbox_at;
+                    inbox.pressed = 0;
+                    inbox.mouse[0] = inbox.mouse[1] = 0;
+                    inbox_at = 0;
+                    tiles.swap(wanted);
+                }
+                if (replay) in = replay->frames[game.steps];
+                step(in, tiles, pushed);
+
+                // a tick that runs long is caught up on, but after a stall of more than a few the clock starts over
+                next += dt;
+                auto now = std::chrono::steady_clock::now();
+                if (now > next) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    late++;
+                }
+                if (now > next + 4 * dt) next = now;
+                std::this_thread::sleep_until(next);
+            }
+            finished = true;
+        }
+
+        // one tick: streaming, the game's step and new meshes of the chunks it edited, then publish;
+        // `pushed` is when the input was handed in, 0 when there was none
+        // NOTE: a replay waits for streaming instead, so it sees the same world on every run
+        void step(input::Input in, const std::vector<int> &tiles, double pushed = 0) {
+            std::lock_guard<std::mutex> world(world_lock);
+            PROFILE_SCOPE("tick");
+            in.dt = input::FIXED_DT;
+            if (recorder) recorder->write(in);
+
+            int pcx = game.chunk_x(), pcz = game.chunk_z();
+            {
+                PROFILE_SCOPE("stream");
+                auto evicted = [this](int cx, int cz) {
+                    meshed.erase(world::key(cx, cz));
+                    made.push_back(Update {cx, cz, nullptr});
+                };
+                auto done = [this](const mesher::ChunkMesh &cm) {
+                    if (!cm.lod) meshed.insert(world::key(cm.cx, cm.cz));
+                    made.push_back(Update {cm.cx, cm.cz, std::unique_ptr<mesher::ChunkMesh>(new mesher::ChunkMesh(cm))});
+                };
+                if (replay) {
+                    streamer.settle(game.level, pcx, pcz, evicted, done);
+                } else {
+                    streamer.update(game.level, pcx, pcz, evicted);
+                    streamer.drain(game.level, budget, done);
+                    streamer.schedule(game.level, pcx, pcz, budget);
+                }
+                for (size_t i = 0; i + 2 < tiles.size(); i += 3) streamer.build(tiles[i], tiles[i + 1], tiles[i + 2]);
+            }
+
+            game.step(in);
+
+            // chunks that were never meshed are still waiting on the streamer, which meshes them as they are now
+            {
+                PROFILE_SCOPE("remesh");
+                for (long long k : game.edited) {
+                    auto it = game.level.chunks.find(k);
+                    if (it == game.level.chunks.end() || !meshed.count(k)) continue;
+                    std::unique_ptr<mesher::ChunkMesh> cm(new mesher::ChunkMesh());
+                    mesher::build(game.level, it->second->cx, it->second->cz, *cm);
+                    made.push_back(Update {it->second->cx, it->second->cz, std::move(cm)});
+                }
+                game.edited.clear();
+            }
+
+            State s = state();
+            std::lock_guard<std::mutex> guard(lock);
+            s.tick = ++ticks;
+            s.at = clock();
+            if (pushed) {
+                inputs++;
+                input_ms = (s.at - pushed) * 1e3;
+                input_max_ms = std::max(input_max_ms, input_ms);
+            }
+            s.input_ms = input_ms;
+            previous = current;
+            current = s;
+            for (Update &u : made) updates.push_back(std::move(u));
+            made.clear();
+        }
+
+        State state() const {
+            const sim::Player &p = game.player;
+            State s;
+            for (int k = 0; k < 3; k++) {
+                s.position[k] = p.position[k];
+                s.target[k] = p.target[k];
+            }
+            s.speed = p.speed;
+            s.free_observe = p.free_observe;
+            s.jumping = !p.grounded && !p.free_observe;
+            s.respawning = game.time - game.respawned_at < 3;
+            s.pick = game.pick;
+            s.selection = game.selection();
+            s.pocket = occlusion::pocket(game.level, (int)floorf(p.position[0]), (int)floorf(p.position[1]), (int)floorf(p.position[2]));
+            s.blocks = game.level.block_count();
+            s.chunks = game.level.chunks.size();
+            s.pending = streamer.pending();
+            s.undo = game.journal.done.size();
+            s.redo = game.journal.undone.size();
+            s.journal_bytes = game.journal.bytes();
+            return s;
+        }
+    };
+}
@@ -0,0 +1,403 @@
+// Chunked voxel storage
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "jobs.cpp"
+#include "perlin.cpp"
+
+// block ids, stored as a single byte per voxel
+enum CubeType : unsigned char { Air = 0, Dirt, Stone, Grass, Lamp };
+
+namespace world
+{
+    const int CHUNK_SIZE = 16;    // x/z extent of a chunk
+    const int CHUNK_HEIGHT = 64;  // y extent, chunks are full-height columns
+    const int CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
+    const int CHUNK_VOLUME = CHUNK_AREA * CHUNK_HEIGHT;
+
+    // floor division / modulo, so negative coordinates land in the right chunk
+    inline int chunk_of(int v) { return (v >= 0 ? v : v - (CHUNK_SIZE - 1)) / CHUNK_SIZE; }
+    inline int local_of(int v) { return v - chunk_of(v) * CHUNK_SIZE; }
+
+    // layout is y-major so a horizontal slice is contiguous
+    inline int index(int lx, int y, int lz) { return (y * CHUNK_SIZE + lz) * CHUNK_SIZE + lx; }
+
+    inline long long key(int cx, int cz) { return ((long long)cx << 32) | (unsigned int)cz; }
+
+    struct Chunk {
+        int cx, cz;
+        int solid = 0;          // number of non-air voxels
+        unsigned revision = 0;  // bumped by every edit through World::set
+        bool unsaved = true;    // changed since it was last saved or loaded
+        unsigned char blocks[CHUNK_VOLUME];
+        short height[CHUNK_AREA];  // top solid y per column, -1 when the column is empty
+        unsigned char light[CHUNK_VOLUME];  // sky light << 4 | block light, kept by light.cpp and never saved
+
+        Chunk(int cx, int cz) : cx(cx), cz(cz) {
+            memset(blocks, Air, sizeof(blocks));
+            memset(light, 0, sizeof(light));
+            for (short &h : height) h = -1;
+        }
+
+        CubeType get(int lx, int y, int lz) const { return (CubeType)blocks[index(lx, y, lz)]; }
+
+        int top(int lx, int lz) const { return height[lz * CHUNK_SIZE + lx]; }
+
+        // solid count and heightmap from scratch, after the blocks were written directly
+        void recount() {
+            solid = 0;
+            for (short &h : height) h = -1;
+            for (int i = 0; i < CHUNK_VOLUME; i++) {
+                if (blocks[i] == Air) continue;
+                solid++;
+                height[i % CHUNK_AREA] = i / CHUNK_AREA;  // y goes up with i
+            }
+        }
+
+        void set(int lx, int y, int lz, CubeType t) {
+            unsigned char &b = blocks[index(lx, y, lz)];
+            solid += (t != Air) - (b != Air);
+            b = t;
+
+            // keep the heightmap in sync, only removing the top block needs a walk down
+            short &h = height[lz * CHUNK_SIZE + lx];
+            if (t != Air) {
+                if (y > h) h = y;
+            } else if (y == h) {
+                while (h >= 0 && blocks[index(lx, h, lz)] == Air) h--;
+            }
+        }
+    };
+
+    struct World {
+        std::unordered_map<long long, std::unique_ptr<Chunk>> chunks;
+
+        Chunk *chunk(int cx, int cz) const {
+            auto it = chunks.find(key(cx, cz));
+            return it == chunks.end() ? nullptr : it->second.get();
+        }
+
+        // get the chunk, allocating an empty one if it is not there yet
+        Chunk *touch(int cx, int cz) {
+            std::unique_ptr<Chunk> &c = chunks[key(cx, cz)];
+            if (!c) c.reset(new Chunk(cx, cz));
+            return c.get();
+        }
+
+        CubeType get(int x, int y, int z) const {
+            if (y < 0 || y >= CHUNK_HEIGHT) return Air;
+            const Chunk *c = chunk(chunk_of(x), chunk_of(z));
+            return c ? c->get(local_of(x), y, local_of(z)) : Air;
+        }
+
+        bool solid(int x, int y, int z) const { return get(x, y, z) != Air; }
+
+        // highest solid y of the (x,z) column, -1 when there is nothing there
+        int top(int x, int z) const {
+            const Chunk *c = chunk(chunk_of(x), chunk_of(z));
+            return c ? c->top(local_of(x), local_of(z)) : -1;
+        }
+
+        void set(int x, int y, int z, CubeType t) {
+            if (y < 0 || y >= CHUNK_HEIGHT) return;
+            Chunk *c = t == Air ? chunk(chunk_of(x), chunk_of(z)) : touch(chunk_of(x), chunk_of(z));
+            if (c) {
+                c->set(local_of(x), y, local_of(z), t);
+                c->revision++;
+                c->unsaved = true;
+            }
+        }
+
+        // true when all six neighbours are solid, i.e. the block can't be seen
+        bool enclosed(int x, int y, int z) const {
+            return solid(x + 1, y, z) && solid(x - 1, y, z) &&
+                   solid(x, y + 1, z) && solid(x, y - 1, z) &&
+                   solid(x, y, z + 1) && solid(x, y, z - 1);
+        }
+
+        size_t block_count() const {
+            size_t n = 0;
+            for (const auto &it : chunks) n += it.second->solid;
+            return n;
+        }
+
+        void clear() { chunks.clear(); }
+    };
+
+    // a block change asked for while a frame runs
+    struct Edit {
+        int x, y, z;
+        CubeType type;
+    };
+
+    // edits are queued during the frame and applied between frames, nothing changes under the draw loop
+    struct EditQueue {
+        std::vector<Edit> edits;
+
+        void push(int x, int y, int z, CubeType t) { edits.push_back(Edit { x, y, z, t }); }
+
+        // apply every queued edit, the chunks that need a new mesh are added to `dirty`; `changed` gets
+        // every block that changed with what it was before
+        // NOTE: a border block also shows or hides faces of the neighbour chunk, its revision is
+        // bumped as well so a mesh of it that was started before the edit is thrown away
+        void apply(World &w, std::unordered_set<long long> &dirty,
+                   const std::function<void(int, int, int, CubeType)> &changed = nullptr) {
+            for (const Edit &e : edits) {
+                CubeType was = w.get(e.x, e.y, e.z);
+                if (e.y < 0 || e.y >= CHUNK_HEIGHT || was == e.type) continue;
+                w.set(e.x, e.y, e.z, e.type);
+
+                int cx = chunk_of(e.x), cz = chunk_of(e.z);
+                int lx = local_of(e.x), lz = local_of(e.z);
+                dirty.insert(key(cx, cz));
+                auto neighbour = [&](int ncx, int ncz) {
+                    Chunk *c = w.chunk(ncx, ncz);
+                    if (!c) return;
+                    c->revision++;
+                    dirty.insert(key(ncx, ncz));
+                };
+                if (lx == 0) neighbour(cx - 1, cz);
+                if (lx == CHUNK_SIZE - 1) neighbour(cx + 1, cz);
+                if (lz == 0) neighbour(cx, cz - 1);
+                if (lz == CHUNK_SIZE - 1) neighbour(cx, cz + 1);
+                // a corner block shades the corner of the diagonal chunk as well
+                int ex = lx == 0 ? -1 : lx == CHUNK_SIZE - 1 ? 1 : 0, ez = lz == 0 ? -1 : lz == CHUNK_SIZE - 1 ? 1 : 0;
+                if (ex && ez) neighbour(cx + ex, cz + ez);
+                if (changed) changed(e.x, e.y, e.z, was);
+            }
+            edits.clear();
+        }
+    };
+
+    // memoized surface heights of generated chunks, keyed by everything that shapes them and the chunk coordinate
+    // NOTE: thread safe, least recently used entries are dropped past `capacity`
+    struct ColumnCache {
+        // the height noise settings and amplitude, two terrains only share heights when all of them match
+        struct Source {
+            int seed, octaves;
+            float frequency, lacunarity, gain, amplitude;
+
+            bool operator==(const Source &o) const {
+                return seed == o.seed && octaves == o.octaves && frequency == o.frequency && lacunarity == o.lacunarity &&
+                       gain == o.gain && amplitude == o.amplitude;
+            }
+        };
+
+        struct Entry {
+            Source source;
+            int cx, cz;
+            short heights[CHUNK_AREA];
+        };
+
+        size_t capacity;
+        size_t hits = 0, misses = 0;
+        std::mutex lock;
+        std::list<Entry> entries;  // most recent first
+        std::unordered_map<unsigned long long, std::list<Entry>::iterator> index;
+
+        ColumnCache(size_t capacity = 4096) : capacity(capacity) {}
+
+        static Source source(const perlin::Noise &n, float amplitude) {
+            return Source { n.seed, n.octaves, n.frequency, n.lacunarity, n.gain, amplitude };
+        }
+
+        // splitmix64 finalizer over each field in turn; a collision only costs a miss, get() checks the entry
+        static unsigned long long slot(const Source &s, int cx, int cz) {
+            unsigned int bits[6];
+            memcpy(&bits[0], &s.frequency, 4);
+            memcpy(&bits[1], &s.lacunarity, 4);
+            memcpy(&bits[2], &s.gain, 4);
+            memcpy(&bits[3], &s.amplitude, 4);
+            bits[4] = (unsigned int)s.seed;
+            bits[5] = (unsigned int)s.octaves;
+            unsigned long long h = (unsigned long long)key(cx, cz);
+            for (unsigned int b : bits) {
+                h = (h ^ b) + 0x9E3779B97F4A7C15ull;
+                h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+                h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+                h ^= h >> 31;
+            }
+            return h;
+        }
+
+        bool get(const Source &s, int cx, int cz, short heights[CHUNK_AREA]) {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = index.find(slot(s, cx, cz));
+            if (it == index.end() || !(it->second->source == s) || it->second->cx != cx || it->second->cz != cz) {
+                misses++;
+                return false;
+            }
+            entries.splice(entries.begin(), entries, it->second);
+            memcpy(heights, it->second->heights, sizeof(it->second->heights));
+            hits++;
+            return true;
+        }
+
+        void put(const Source &s, int cx, int cz, const short heights[CHUNK_AREA]) {
+            std::lock_guard<std::mutex> guard(lock);
+            unsigned long long k = slot(s, cx, cz);
+            auto it = index.find(k);
+            if (it != index.end()) entries.erase(it->second);
+            entries.push_front(Entry { s, cx, cz, {} });
+            memcpy(entries.front().heights, heights, sizeof(entries.front().heights));
+            index[k] = entries.begin();
+            while (entries.size() > capacity) {
+                const Entry &last = entries.back();
+                index.erase(slot(last.source, last.cx, last.cz));
+                entries.pop_back();
+            }
+        }
+    };
+
+    const int CAVE_LATTICE = 8;  // cave density is sampled every this many blocks on x and z, and blended between
+    const int CAVE_LAYER = 4;    // and on y
+    const int CAVE_FLOOR = 4;    // the band of y caves are dug in, under it stays solid ground over the stone floor
+    const int CAVE_CEILING = 16;
+
+    // terrain settings, the noise decides the surface height of every column and the cave noise what is dug out under it
+    struct Terrain {
+        perlin::Noise noise;
+        float amplitude = 10;          // height of the tallest possible column
+        perlin::Noise caves = perlin::Noise(perlin::SEED + 1, 1, 0.05f);
+        float hollow = 0.62f;          // cave density above this is air, 1 for no caves
+        float squash = 1.75f;          // cave noise runs this much faster on y, caves are wider than they are tall
+        ColumnCache *cache = nullptr;  // optional
+    };
+
+    // surface heights of chunk (cx, cz), from the cache when it was generated before
+    void heights(const Terrain &t, int cx, int cz, short out[CHUNK_AREA]) {
+        ColumnCache::Source source = ColumnCache::source(t.noise, t.amplitude);
+        if (t.cache && t.cache->get(source, cx, cz, out)) return;
+
+        float noise[CHUNK_AREA];
+        t.noise.fbm2d_grid(cx * CHUNK_SIZE, cz * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, noise);
+        for (int i = 0; i < CHUNK_AREA; i++) {
+            int h = (int)(noise[i] * t.amplitude);
+            out[i] = h < CHUNK_HEIGHT - 2 ? h : CHUNK_HEIGHT - 2;
+        }
+
+        if (t.cache) t.cache->put(source, cx, cz, out);
+    }
+
+    // marks the blocks of chunk (cx, cz) a cave goes through in `air`, by index(); only up to each column's `top`
+    // and CAVE_CEILING
+    // NOTE: the density is sampled on CAVE_LATTICE x CAVE_LAYER points in world coordinates, so chunks next to each other share
+    // the points on their border, and blended in between. A lattice cell above the columns under it or the band is skipped,
+    // its points are only sampled when a cell needs them; and as a blend never leaves the range of its corners, a
+    // cell whose corners are all on one side of `hollow` is filled in whole without blending
+    void carve(const Terrain &t, int cx, int cz, const short top[CHUNK_AREA], unsigned char air[CHUNK_VOLUME]) {
+        const int n = CHUNK_SIZE / CAVE_LATTICE + 1, levels = (CAVE_CEILING - CAVE_FLOOR) / CAVE_LAYER + 2;
+        float lattice[levels * n * n];
+        for (float &v : lattice) v = -1;
+        auto sample = [&](int j, int k, int i) {
+            float &v = lattice[(j * n + k) * n + i];
+            if (v < 0) v = t.caves.fbm3d(cx * CHUNK_SIZE + i * CAVE_LATTICE, (CAVE_FLOOR + j * CAVE_LAYER) * t.squash, cz * CHUNK_SIZE + k * CAVE_LATTICE);
+            return v;
+        };
+
+        const float step = 1.0f / CAVE_LATTICE, layer = 1.0f / CAVE_LAYER;
+        for (int k = 0; k + 1 < n; k++) {
+            for (int i = 0; i + 1 < n; i++) {
+                int high = -1;
+                for (int dz = 0; dz < CAVE_LATTICE; dz++)
+                    for (int dx = 0; dx < CAVE_LATTICE; dx++) high = std::max<int>(high, top[(k * CAVE_LATTICE + dz) * CHUNK_SIZE + i * CAVE_LATTICE + dx]);
+                high = std::min(high, CAVE_CEILING);
+
+                for (int j = 0; CAVE_FLOOR + j * CAVE_LAYER <= high; j++) {
+                    float c[8], lo = 1, hi = 0;
+                    for (int m = 0; m < 8; m++) {
+                        c[m] = sample(j + (m >> 2), k + (m >> 1 & 1), i + (m & 1));
+                        lo = std::min(lo, c[m]);
+                        hi = std::max(hi, c[m]);
+                    }
+                    if (hi <= t.hollow) continue;
+                    bool all = lo > t.hollow;
+                    int y1 = std::min(CAVE_FLOOR + (j + 1) * CAVE_LAYER, high + 1);
+                    for (int y = CAVE_FLOOR + j * CAVE_LAYER; y < y1; y++) {
+                        // the blend done an axis at a time: y for the four corner edges, z for both ends of a row, x along it
+                        float fy = (y - CAVE_FLOOR - j * CAVE_LAYER) * layer, e[4];
+                        for (int m = 0; m < 4; m++) e[m] = perlin::lin_inter(c[m], c[m + 4], fy);
+                        for (int dz = 0; dz < CAVE_LATTICE; dz++) {
+                            unsigned char *row = &air[index(i * CAVE_LATTICE, y, k * CAVE_LATTICE + dz)];
+                            if (all) {
+                                memset(row, 1, CAVE_LATTICE);
+                                continue;
+                            }
+                            float fz = dz * step;
+                            float x0 = perlin::lin_inter(e[0], e[2], fz), x1 = perlin::lin_inter(e[1], e[3], fz);
+                            for (int dx = 0; dx < CAVE_LATTICE; dx++) row[dx] = perlin::lin_inter(x0, x1, dx * step) > t.hollow;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // random map generate, the height columns of chunk c with caves dug out of them; a size > 0 keeps them
+    // inside a size x size square; returns whether the cave noise was looked at
+    // NOTE: a column only depends on its own (x, z) and the cave lattice, so chunks can be generated in any order.
+    // Caves are only dug between CAVE_FLOOR and CAVE_CEILING: a chunk whose highest column ends below the band is
+    // filled as plain columns, without sampling any cave noise or looking at `air`. In the others carve() skips the
+    // lattice cells above the columns under them and above the band
+    bool generate(Chunk &c, const Terrain &terrain, int size = 0) {
+        short surface[CHUNK_AREA], top[CHUNK_AREA];
+        heights(terrain, c.cx, c.cz, surface);
+
+        // the grass block goes one above the last dirt, at y 1 for an empty column
+        int high = 0;
+        for (int i = 0; i < CHUNK_AREA; i++) {
+            top[i] = std::max<short>(surface[i], 1);
+            high = std::max<int>(high, top[i]);
+        }
+        // the columns hold y 0 to `high`, which misses the band when every block is under its floor
+        bool carved = terrain.hollow < 1 && high >= CAVE_FLOOR;
+        static thread_local unsigned char air[CHUNK_VOLUME];
+        if (carved) {
+            memset(air + CAVE_FLOOR * CHUNK_AREA, 0, (CAVE_CEILING - CAVE_FLOOR + 1) * CHUNK_AREA);
+            carve(terrain, c.cx, c.cz, top, air);
+        }
+
+        for (int lz = 0; lz < CHUNK_SIZE; lz++) {
+            for (int lx = 0; lx < CHUNK_SIZE; lx++) {
+                int xx = c.cx * CHUNK_SIZE + lx, yy = c.cz * CHUNK_SIZE + lz;
+                if (size > 0 && (xx < 0 || yy < 0 || xx >= size || yy >= size)) continue;
+                auto put = [&](int y, CubeType type) {
+                    if (!carved || y < CAVE_FLOOR || y > CAVE_CEILING || !air[index(lx, y, lz)]) c.set(lx, y, lz, type);
+                };
+                for (int y = 0; y < surface[lz * CHUNK_SIZE + lx]; y++) put(y, y < 1 ? CubeType::Stone : CubeType::Dirt);
+                put(top[lz * CHUNK_SIZE + lx], CubeType::Grass);
+            }
+        }
+        return carved;
+    }
+
+    // generate every chunk of the map, one job per chunk spread over the pool and the calling thread
+    void populate(World &w, const Terrain &terrain, int size, jobs::Pool &pool) {
+        int n = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        std::vector<std::unique_ptr<Chunk>> made(n * n);
+
+        // chunks are allocated by the workers too, only the map insert at the end is serial
+        pool.run(pool.channel("populate"), n * n, [&](int i) {
+            made[i].reset(new Chunk(i / n, i % n));
+            generate(*made[i], terrain, size);
+        });
+
+        for (auto &c : made) w.chunks[key(c->cx, c->cz)] = std::move(c);
+    }
+
+    // the same on a pool of its own with `threads` threads counting the caller (0 = all cores)
+    void populate(World &w, const Terrain &terrain, int size, int threads = 0) {
+        if (threads <= 0) threads = std::thread::hardware_concurrency();
+        if (threads <= 0) threads = 1;
+        jobs::Pool pool(threads - 1);
+        populate(w, terrain, size, pool);
+    }
+}